@@ -0,0 +1,18 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    ../src/bench/DecodeBench.cpp \
+    ../src/Disassembler.cpp \
+    ../src/Mnemonic.cpp
+
+HEADERS += \
+    ../src/Disassembler.hpp \
+    ../src/Globals.hpp \
+    ../src/Mnemonic.hpp
+
+INCLUDEPATH += ../src
+LIBS += -lbfd -ldl -liberty -lopcodes
+TARGET = decodebench
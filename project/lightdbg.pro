@@ -21,10 +21,21 @@ SOURCES += \
     ../src/Globals.cpp \
     ../src/commands/CommandBreakpoint.cpp \
     ../src/SymbolTable.cpp \
-    ../src/Symbol.cpp \
     ../src/commands/CommandStack.cpp \
     ../src/commands/CommandMemory.cpp \
-    ../src/Tracee.cpp
+    ../src/Tracee.cpp \
+    ../src/Disassembler.cpp \
+    ../src/ElfImage.cpp \
+    ../src/ParallelDisassembler.cpp \
+    ../src/ThreadPool.cpp \
+    ../src/SharedObjects.cpp \
+    ../src/MemoryMap.cpp \
+    ../src/PatternScanner.cpp \
+    ../src/ReferenceScanner.cpp \
+    ../src/ValueScanner.cpp \
+    ../src/MemorySnapshot.cpp \
+    ../src/TraceFile.cpp \
+    ../src/AsyncWriter.cpp
 
 HEADERS += \
     ../src/DebugLoop.hpp \
@@ -47,8 +58,20 @@ HEADERS += \
     ../src/Symbol.hpp \
     ../src/commands/CommandStack.hpp \
     ../src/commands/CommandMemory.hpp \
-    ../src/Tracee.hpp
+    ../src/Tracee.hpp \
+    ../src/Disassembler.hpp \
+    ../src/ElfImage.hpp \
+    ../src/ParallelDisassembler.hpp \
+    ../src/ThreadPool.hpp \
+    ../src/SharedObjects.hpp \
+    ../src/MemoryMap.hpp \
+    ../src/PatternScanner.hpp \
+    ../src/ReferenceScanner.hpp \
+    ../src/ValueScanner.hpp \
+    ../src/MemorySnapshot.hpp \
+    ../src/TraceFile.hpp \
+    ../src/AsyncWriter.hpp
 
 INCLUDEPATH += ../src
-LIBS += -lbfd -ldl -liberty -lopcodes -lz
+LIBS += -lbfd -ldl -liberty -lopcodes -lpthread -lz
 TARGET = ldb
@@ -0,0 +1,19 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    ../src/bench/SymbolBench.cpp \
+    ../src/SymbolTable.cpp \
+    ../src/ElfImage.cpp
+
+HEADERS += \
+    ../src/Globals.hpp \
+    ../src/SymbolTable.hpp \
+    ../src/Symbol.hpp \
+    ../src/ElfImage.hpp
+
+INCLUDEPATH += ../src
+LIBS += -lbfd -ldl -liberty -lpthread
+TARGET = symbolbench
@@ -0,0 +1,392 @@
+#include "AsyncWriter.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <stdexcept>
+#include <string>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+AsyncWriter::AsyncWriter(int file, AsyncWriterOverflow overflow, int compression, word ringBytes)
+    : file(file), head(0), tail(0), overflow(overflow), droppedCount(0), droppedBytes(0), compressing(false), error(0), stopping(false), sleeping(false)
+{
+    //Create the gzip stream (the file is closed on failure as it would be later):
+    if (compression != ASYNC_WRITER_UNCOMPRESSED)
+    {
+        memset(&this->stream, 0, sizeof(this->stream));
+
+        if (deflateInit2(&this->stream, compression, Z_DEFLATED, ASYNC_WRITER_GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            close(file);
+            throw runtime_error("Failed to initialize the compression.");
+        }
+
+        this->compressing = true;
+        this->compressed.resize(ASYNC_WRITER_COMPRESSED_BYTES);
+        this->stream.next_out = this->compressed.data();
+        this->stream.avail_out = this->compressed.size();
+    }
+
+    //Round up to a power of two:
+    word size = 1;
+
+    while (size < ringBytes)
+    {
+        size <<= 1;
+    }
+
+    this->ring.resize(size);
+    this->mask = size - 1;
+
+    //Start the writer:
+    this->writer = thread(&AsyncWriter::work, this);
+}
+
+
+AsyncWriter::~AsyncWriter()
+{
+    //The writer drains the ring before it leaves:
+    this->stopping.store(true);
+
+    {
+        lock_guard<mutex> guard(this->lock);
+    }
+
+    this->dataPushed.notify_all();
+    this->writer.join();
+
+    if (this->compressing)
+    {
+        deflateEnd(&this->stream);
+    }
+
+    close(this->file);
+}
+
+
+void AsyncWriter::work()
+{
+    while (true)
+    {
+        word start = this->tail.load(memory_order_relaxed);
+        word end = this->head.load(memory_order_acquire);
+
+        //Nothing to do, sleep until the next push:
+        if (start == end)
+        {
+            if (this->stopping.load())
+            {
+                //Write the end of the gzip stream:
+                if (this->compressing)
+                {
+                    compressRange(start, start, Z_FINISH);
+                }
+
+                return;
+            }
+
+            unique_lock<mutex> guard(this->lock);
+
+            while ((this->head.load(memory_order_acquire) == start) && !this->stopping.load())
+            {
+                this->sleeping = true;
+                this->dataWritten.notify_all();
+                this->dataPushed.wait(guard);
+                this->sleeping = false;
+            }
+
+            continue;
+        }
+
+        //Write everything that is there:
+        if (this->compressing)
+        {
+            compressRange(start, end, Z_SYNC_FLUSH);
+        }
+        else
+        {
+            writeRange(start, end);
+        }
+
+        //After an error the data is discarded, so the producer does not wait forever:
+        this->tail.store(end, memory_order_release);
+
+        {
+            lock_guard<mutex> guard(this->lock);
+        }
+
+        this->dataWritten.notify_all();
+    }
+}
+
+
+void AsyncWriter::writeRange(word start, word end)
+{
+    //The part behind the wrap around goes into the same call:
+    while ((start != end) && !this->error.load())
+    {
+        struct iovec parts[2];
+        word offset = start & this->mask;
+        word count = end - start;
+        int partCount = 1;
+
+        parts[0].iov_base = this->ring.data() + offset;
+        parts[0].iov_len = count;
+
+        if (offset + count > this->ring.size())
+        {
+            parts[0].iov_len = this->ring.size() - offset;
+            parts[1].iov_base = this->ring.data();
+            parts[1].iov_len = count - parts[0].iov_len;
+            partCount = 2;
+        }
+
+        ssize_t result = writev(this->file, parts, partCount);
+
+        if (result < 0)
+        {
+            if (errno != EINTR)
+            {
+                this->error.store(errno);
+            }
+
+            continue;
+        }
+
+        start += result;
+    }
+}
+
+
+void AsyncWriter::writeCompressed()
+{
+    word count = this->compressed.size() - this->stream.avail_out;
+    word written = 0;
+
+    while ((written < count) && !this->error.load())
+    {
+        ssize_t result = write(this->file, this->compressed.data() + written, count - written);
+
+        if (result < 0)
+        {
+            if (errno != EINTR)
+            {
+                this->error.store(errno);
+            }
+
+            continue;
+        }
+
+        written += result;
+    }
+
+    this->stream.next_out = this->compressed.data();
+    this->stream.avail_out = this->compressed.size();
+}
+
+
+void AsyncWriter::compressRange(word start, word end, int flush)
+{
+    //Both parts of a wrap around, the flush comes with the last one:
+    while (true)
+    {
+        word offset = start & this->mask;
+        word count = min(end - start, (word)this->ring.size() - offset);
+        bool last = (start + count == end);
+
+        this->stream.next_in = this->ring.data() + offset;
+        this->stream.avail_in = count;
+
+        //Deflate until all input is consumed and the flush is complete.
+        //If the output was filled up, zlib may still hold a part of the flush (remembered before the output is reset):
+        bool full;
+
+        do
+        {
+            int result = deflate(&this->stream, last ? flush : Z_NO_FLUSH);
+
+            //No progress (Z_BUF_ERROR) just means there was nothing left to do:
+            if ((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR))
+            {
+                //zlib has no errno, the stream is unusable from here on:
+                this->error.store(EIO);
+                return;
+            }
+
+            full = (this->stream.avail_out == 0);
+
+            if (full)
+            {
+                writeCompressed();
+            }
+        }
+        while ((this->stream.avail_in != 0) || (last && full));
+
+        if (last)
+        {
+            break;
+        }
+
+        start += count;
+    }
+
+    writeCompressed();
+}
+
+
+bool AsyncWriter::push(const void* data, word count)
+{
+    word position = this->head.load(memory_order_relaxed);
+
+    //Too large for the ring at all:
+    if (count > this->ring.size())
+    {
+        this->droppedCount++;
+        this->droppedBytes += count;
+
+        return false;
+    }
+
+    //Is there enough space?
+    if (position + count - this->tail.load(memory_order_acquire) > this->ring.size())
+    {
+        if (this->overflow == ASYNC_WRITER_OVERFLOW_DROP)
+        {
+            this->droppedCount++;
+            this->droppedBytes += count;
+
+            return false;
+        }
+
+        //Wait for the writer:
+        unique_lock<mutex> guard(this->lock);
+
+        while (position + count - this->tail.load(memory_order_acquire) > this->ring.size())
+        {
+            this->dataWritten.wait(guard);
+        }
+    }
+
+    //Copy (maybe in two parts):
+    word offset = position & this->mask;
+    word first = min(count, (word)this->ring.size() - offset);
+
+    memcpy(this->ring.data() + offset, data, first);
+    memcpy(this->ring.data(), (const byte*)data + first, count - first);
+
+    //Publish and wake up the writer:
+    this->head.store(position + count, memory_order_release);
+
+    {
+        lock_guard<mutex> guard(this->lock);
+    }
+
+    this->dataPushed.notify_one();
+
+    return true;
+}
+
+
+void AsyncWriter::flush()
+{
+    word position = this->head.load(memory_order_relaxed);
+
+    //Wait for the writer:
+    {
+        unique_lock<mutex> guard(this->lock);
+
+        while ((this->tail.load(memory_order_acquire) != position) || !this->sleeping)
+        {
+            this->dataWritten.wait(guard);
+        }
+    }
+
+    int error = this->error.load();
+
+    if (error)
+    {
+        throw runtime_error(string("Writing the trace file has failed: ") + strerror(error) + ".");
+    }
+}
+
+
+AsyncWriterBuffer::AsyncWriterBuffer(int file, AsyncWriterOverflow overflow, int compression, word bufferBytes)
+    : writer(file, overflow, compression), buffer(bufferBytes)
+{
+    setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+}
+
+
+AsyncWriterBuffer::~AsyncWriterBuffer()
+{
+    pushBuffer(true);
+}
+
+
+void AsyncWriterBuffer::pushBuffer(bool everything)
+{
+    char* end = pptr();
+
+    //Dropping must not cut a line, so only whole ones are pushed:
+    if (!everything)
+    {
+        char* newline = end;
+
+        while ((newline > pbase()) && (newline[-1] != '\n'))
+        {
+            newline--;
+        }
+
+        if (newline > pbase())
+        {
+            end = newline;
+        }
+    }
+
+    this->writer.push(pbase(), end - pbase());
+
+    //Move the rest to the front:
+    word rest = pptr() - end;
+    memmove(this->buffer.data(), end, rest);
+
+    setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+    pbump(rest);
+}
+
+
+AsyncWriterBuffer::int_type AsyncWriterBuffer::overflow(int_type character)
+{
+    pushBuffer(false);
+
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        //There is space for it now:
+        if (pptr() == epptr())
+        {
+            pushBuffer(true);
+        }
+
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(character);
+}
+
+
+int AsyncWriterBuffer::sync()
+{
+    pushBuffer(true);
+
+    try
+    {
+        this->writer.flush();
+    }
+    catch (const runtime_error& rt)
+    {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include "Globals.hpp"
+
+//The default size of the ring (a power of two):
+#define ASYNC_WRITER_RING_BYTES (16 * 1024 * 1024)
+
+//The compression level for writing uncompressed:
+#define ASYNC_WRITER_UNCOMPRESSED (-1)
+
+//The window bits for a gzip stream (15 plus 16 for the gzip header):
+#define ASYNC_WRITER_GZIP_WINDOW_BITS 31
+
+//The output buffer of the compression:
+#define ASYNC_WRITER_COMPRESSED_BYTES (256 * 1024)
+
+using namespace std;
+
+//What happens if the ring is full:
+enum AsyncWriterOverflow
+{
+    ASYNC_WRITER_OVERFLOW_BLOCK,
+    ASYNC_WRITER_OVERFLOW_DROP
+};
+
+//Writes to a file descriptor on its own thread.
+//One producer copies the data into a ring, the writer thread drains it with writev.
+//The ring positions are lock-free, the mutex is only used to sleep and wake up.
+//Optionally the writer thread compresses to gzip, each batch ends with a sync flush so the file is readable while written:
+class AsyncWriter
+{
+    //Members:
+private:
+
+    //The file descriptor (owned):
+    int file;
+
+    //The ring, its size is a power of two:
+    vector<byte> ring;
+    word mask;
+
+    //The total number of bytes pushed resp. written (the positions in the ring are these masked):
+    atomic<word> head;
+    atomic<word> tail;
+
+    //What to do if the ring is full:
+    AsyncWriterOverflow overflow;
+
+    //The number of pushes resp. bytes that were dropped:
+    word droppedCount;
+    word droppedBytes;
+
+    //The gzip stream and its output buffer (only used by the writer thread):
+    bool compressing;
+    z_stream stream;
+    vector<byte> compressed;
+
+    //Did writing fail (the errno then)?
+    atomic<int> error;
+
+    //Should the writer leave?
+    atomic<bool> stopping;
+
+    //Does the writer sleep until the next push (guarded by the lock)?
+    bool sleeping;
+
+    //The writer thread:
+    thread writer;
+
+    //Used to sleep while the ring is empty resp. full:
+    mutex lock;
+    condition_variable dataPushed;
+    condition_variable dataWritten;
+
+    //Methods:
+private:
+
+    //The loop of the writer thread:
+    void work();
+
+    //Write a range of the ring:
+    void writeRange(word start, word end);
+
+    //Compress a range of the ring and write the result:
+    void compressRange(word start, word end, int flush);
+
+    //Write the compressed output and reset it:
+    void writeCompressed();
+
+public:
+
+    //Getters:
+    inline AsyncWriterOverflow getOverflow() const { return this->overflow; }
+    inline word getDroppedCount() const { return this->droppedCount; }
+    inline word getDroppedBytes() const { return this->droppedBytes; }
+
+    //Constructor (takes the file descriptor, closes it in the end, compression is a zlib level):
+    AsyncWriter(int file, AsyncWriterOverflow overflow, int compression = ASYNC_WRITER_UNCOMPRESSED, word ringBytes = ASYNC_WRITER_RING_BYTES);
+
+    //Not copyable (it owns a thread):
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    //Destructor (writes what is left):
+    virtual ~AsyncWriter();
+
+    //Queue data to be written (false if it was dropped):
+    bool push(const void* data, word count);
+
+    //Wait until everything pushed so far is written and the writer sleeps again (so it's idle e.g. for forking):
+    void flush();
+};
+
+//A stream buffer that hands whole lines to an async writer:
+class AsyncWriterBuffer: public streambuf
+{
+    //Members:
+private:
+
+    //The writer:
+    AsyncWriter writer;
+
+    //The buffer:
+    vector<char> buffer;
+
+    //Methods:
+private:
+
+    //Push the complete lines (or everything) and keep the rest:
+    void pushBuffer(bool everything);
+
+protected:
+
+    //The buffer is full:
+    virtual int_type overflow(int_type character);
+
+    //Flush:
+    virtual int sync();
+
+public:
+
+    //Get the writer (for its statistics):
+    inline const AsyncWriter& getWriter() const { return this->writer; }
+
+    //Constructor (takes the file descriptor like the writer):
+    AsyncWriterBuffer(int file, AsyncWriterOverflow overflow, int compression, word bufferBytes);
+
+    //Destructor (writes what is left):
+    virtual ~AsyncWriterBuffer();
+};
+
+#endif // ASYNCWRITER_H
@@ -1,5 +1,6 @@
 #include "Breakpoint.hpp"
 
+#include <algorithm>
 #include <string.h>
 
 Breakpoint::Breakpoint(Tracee& tracee, pword address)
@@ -9,22 +10,26 @@ Breakpoint::Breakpoint(Tracee& tracee, pword address)
     memset(this->data, 0, MAX_BREAKPOINT_INSTRUCTION_WORDS * WORD_SIZE_BYTES);
 
     //Read it:
-    for (int i = 0; i < MAX_BREAKPOINT_INSTRUCTION_WORDS; i++)
-    {
-        this->data[i] = this->tracee.peekWord(this->address + i);
-    }
+    this->tracee.peekToPtr(this->address, MAX_BREAKPOINT_INSTRUCTION_WORDS * WORD_SIZE_BYTES, (pbyte)this->data);
 }
 
 
 void Breakpoint::setInstalled(bool flag)
 {
+    //Nothing to do (this avoids needless writes to the code on every stop):
+    if (flag == this->installed)
+    {
+        return;
+    }
+
     //Which are the bytes used as replacement?
     pword overwritingBuffer = (flag ? breakpointInstruction : this->data);
 
     //Read the last word if the breakpoint instruction is not aligned (there are "dead bytes"):
     if (BREAKPOINT_INSTRUCTION_DEAD_BYTES)
     {
-        word lastWord = this->tracee.peekWord(this->address + MAX_BREAKPOINT_INSTRUCTION_WORDS - 1);
+        word lastWord = 0;
+        this->tracee.peekToPtr(this->address + MAX_BREAKPOINT_INSTRUCTION_WORDS - 1, WORD_SIZE_BYTES, (pbyte)&lastWord);
 
         //Insert the end of the last word into the end of the overwriting buffer:
         memcpy(((pbyte)&overwritingBuffer[MAX_BREAKPOINT_INSTRUCTION_WORDS]) - BREAKPOINT_INSTRUCTION_DEAD_BYTES, ((pbyte)(&lastWord + 1)) - BREAKPOINT_INSTRUCTION_DEAD_BYTES, BREAKPOINT_INSTRUCTION_DEAD_BYTES);
@@ -35,4 +40,20 @@ void Breakpoint::setInstalled(bool flag)
     {
         this->tracee.pokeWord(this->address + i, overwritingBuffer[i]);
     }
+
+    //Mark:
+    this->installed = flag;
+}
+
+
+void Breakpoint::updateData(pword address, word count, const byte* ptr)
+{
+    //The overlap of the written range and the saved data:
+    word start = max((word)address, (word)this->address);
+    word end = min((word)address + count, (word)this->address + sizeof(this->data));
+
+    if (start < end)
+    {
+        memcpy(((pbyte)this->data) + (start - (word)this->address), ptr + (start - (word)address), end - start);
+    }
 }
@@ -36,6 +36,10 @@ public:
     //Get/Set the installed state:
     inline bool isInstalled() const { return this->installed; }
     void setInstalled(bool flag);
+
+    //Take over the bytes written to a range while the breakpoint is not installed.
+    //Otherwise deinstalling it later would restore the bytes from before the write:
+    void updateData(pword address, word count, const byte* ptr);
 };
 
 #endif // BREAKPOINT_H
@@ -21,6 +21,7 @@
 #include "commands/CommandDetach.hpp"
 #include "commands/CommandDisassemble.hpp"
 #include "commands/CommandExit.hpp"
+#include "commands/CommandMemory.hpp"
 #include "commands/CommandObfuscate.hpp"
 #include "commands/CommandRegisters.hpp"
 #include "commands/CommandStack.hpp"
@@ -79,14 +80,302 @@ void DebugLoop::performInitialization()
 
     this->tracee.initialize();
     this->initialized = true;
+
+    //Find the dynamic linker and the already loaded libraries (if attached):
+    this->tracee.getSharedObjects().initialize();
+    updateSharedObjects();
+}
+
+
+void DebugLoop::updateSharedObjects()
+{
+    int loadedCount = this->tracee.getSharedObjects().update();
+
+    if (loadedCount > 0)
+    {
+        cout << "Loaded the symbols of " << loadedCount << " shared object" << ((loadedCount == 1) ? "" : "s") << "." << endl;
+    }
+
+    //Move the library breakpoint (the breakpoints are deinstalled at that point):
+    pword address = (pword)this->tracee.getSharedObjects().getBreakpointAddress();
+
+    if (this->libraryBreakpoint && (this->libraryBreakpoint->getAddress() == address))
+    {
+        return;
+    }
+
+    delete this->libraryBreakpoint;
+    this->libraryBreakpoint = NULL;
+
+    if (address && (this->breakpoints.find(address) == this->breakpoints.end()))
+    {
+        try
+        {
+            this->libraryBreakpoint = new Breakpoint(this->tracee, address);
+        }
+        catch (const runtime_error& err)
+        {
+            //No notifications then.
+        }
+    }
+}
+
+
+//Can a syscall change the mappings (so decoded code may be stale and the binary may have moved)?
+static bool changesMappings(word number)
+{
+#ifdef __i386__
+    if (number == SYSCALL_MMAP2)
+    {
+        return true;
+    }
+#endif
+
+    return (number == SYSCALL_EXECVE) || (number == SYSCALL_MMAP) || (number == SYSCALL_MUNMAP) || (number == SYSCALL_MPROTECT) || (number == SYSCALL_MREMAP);
+}
+
+
+void DebugLoop::checkSteppedSyscall()
+{
+    //Stepping over a syscall produces no syscall stops, but the number is still there:
+    word number = this->tracee.getRegisters().REG_ORIG_AX;
+
+    if (changesMappings(number))
+    {
+        this->tracee.invalidateDecodeCache();
+        this->tracee.invalidateLoadBias();
+        this->tracee.getMemoryMap().invalidate();
+    }
 }
 
 
 void DebugLoop::performTrace()
 {
+    //Did the last step enter the kernel?
+    if (this->steppedSyscall)
+    {
+        checkSteppedSyscall();
+    }
+
     //Trace the mnemonic:
     Mnemonic mnemonic = this->tracee.disassemble(false);
     this->tracer.trace(mnemonic, this->tracee.getRegisters());
+
+    this->steppedSyscall = mnemonic.isSyscall();
+}
+
+
+void DebugLoop::performBlockTrace()
+{
+    struct user_regs_struct registers = this->tracee.getRegisters();
+    word target = registers.REG_IP;
+
+    //Walk the decoded instructions from the start of the block to the branch that was taken.
+    //A conditional branch to the target may have been not taken if a later branch reaches the target as well (like "je L; ...; jmp L"),
+    //so the walk goes on up to the first branch that is always taken. That one is preferred, the first conditional one otherwise:
+    vector<word> addresses;
+    vector<Mnemonic> mnemonics;
+    word current = this->blockStart;
+    bool found = false;
+    bool ambiguous = false;
+    size_t endCount = 0;
+    BranchType endType = BRANCH_TYPE_NONE;
+
+    try
+    {
+        for (int i = 0; i < MAX_TRACE_BLOCK_INSTRUCTIONS; i++)
+        {
+            Mnemonic mnemonic = this->tracee.disassemble((pword)current, false);
+            word next = current + mnemonic.getOpcodeLength();
+
+            addresses.push_back(current);
+            mnemonics.push_back(mnemonic);
+
+            word branchTarget;
+            BranchType type = mnemonic.getBranchType(current, branchTarget);
+
+            //A possible end (the walk goes on):
+            if ((type == BRANCH_TYPE_CONDITIONAL) && (branchTarget == target))
+            {
+                ambiguous = ambiguous || found;
+
+                if (!found)
+                {
+                    found = true;
+                    endCount = addresses.size();
+                    endType = type;
+                }
+            }
+            //The end of the straight-line code.
+            //It wins over a conditional branch before it if it reaches the target as well (the target of an indirect one is unknown):
+            else if ((type == BRANCH_TYPE_DIRECT) || (type == BRANCH_TYPE_INDIRECT) || ((type == BRANCH_TYPE_SYSTEM) && (next == target)))
+            {
+                if (!found || ((type == BRANCH_TYPE_DIRECT) && (branchTarget == target)) || (type == BRANCH_TYPE_SYSTEM))
+                {
+                    ambiguous = found;
+                    found = true;
+                    endCount = addresses.size();
+                    endType = type;
+                }
+
+                break;
+            }
+
+            //Undecodable:
+            if (mnemonic.getOpcodeLength() <= 0)
+            {
+                break;
+            }
+
+            current = next;
+        }
+    }
+    catch (const runtime_error& rt)
+    {
+        //Behind a possible end the code may be unreadable:
+        if (!found)
+        {
+            throw;
+        }
+    }
+
+    //Lost track (the code has changed or was decoded wrongly)? Then only the target is known:
+    if (!found)
+    {
+        addresses.erase(addresses.begin() + 1, addresses.end());
+        mnemonics.erase(mnemonics.begin() + 1, mnemonics.end());
+    }
+    else
+    {
+        //Drop what was walked behind the end:
+        addresses.resize(endCount);
+        mnemonics.erase(mnemonics.begin() + endCount, mnemonics.end());
+
+        if (ambiguous)
+        {
+            this->ambiguousBlocks++;
+        }
+
+        //A syscall ends the block, the target and everything after it must be decoded from the current mappings:
+        if (endType == BRANCH_TYPE_SYSTEM)
+        {
+            checkSteppedSyscall();
+        }
+    }
+
+    //The target is the last step and the start of the next block:
+    addresses.push_back(target);
+    mnemonics.push_back(this->tracee.disassemble((pword)target, false));
+
+    this->tracer.traceBlock(addresses, mnemonics, &registers);
+    this->blockStart = target;
+}
+
+
+void DebugLoop::finishBlockTrace()
+{
+    //The process has left in the middle of a block, most likely by the syscall that ends the straight-line code:
+    vector<word> addresses;
+    vector<Mnemonic> mnemonics;
+    word current = this->blockStart;
+
+    try
+    {
+        for (int i = 0; i < MAX_TRACE_BLOCK_INSTRUCTIONS; i++)
+        {
+            Mnemonic mnemonic = this->tracee.disassemble((pword)current, false);
+
+            addresses.push_back(current);
+            mnemonics.push_back(mnemonic);
+
+            word branchTarget;
+            BranchType type = mnemonic.getBranchType(current, branchTarget);
+
+            if (type == BRANCH_TYPE_SYSTEM)
+            {
+                break;
+            }
+
+            //Conditional branches were not taken, any other would have stopped us, so the end is unknown:
+            if ((type == BRANCH_TYPE_DIRECT) || (type == BRANCH_TYPE_INDIRECT) || (mnemonic.getOpcodeLength() <= 0) || (i + 1 == MAX_TRACE_BLOCK_INSTRUCTIONS))
+            {
+                return;
+            }
+
+            current += mnemonic.getOpcodeLength();
+        }
+    }
+    catch (const runtime_error& rt)
+    {
+        //The code is gone with the process (only the binary itself can be read):
+        return;
+    }
+
+    //The syscall is the last step (the registers are gone):
+    this->tracer.traceBlock(addresses, mnemonics, NULL);
+}
+
+
+void DebugLoop::performBlockStep()
+{
+    //The probe has passed, so this is unlikely. The block so far is traced, go on step by step:
+    if (!this->tracee.performBlockStep())
+    {
+        this->blockSteppingWorks = false;
+        this->blockTracing = false;
+
+        cout << "The kernel does not support block steps, tracing with single steps." << endl;
+        this->tracee.performStep();
+    }
+}
+
+
+void DebugLoop::stopTrace()
+{
+    if (this->ambiguousBlocks > 0)
+    {
+        cout << this->ambiguousBlocks << " block(s) of the trace could have ended at more than one branch to the same target (an unconditional one was preferred, the first one otherwise)." << endl;
+        this->ambiguousBlocks = 0;
+    }
+
+    this->tracer.setTracingActive(false);
+}
+
+
+void DebugLoop::startTrace(bool blocks)
+{
+    //Check once if block steps stop on taken branches only (the branch trap flag is missing in some VMs):
+    if (blocks && !this->blockSteppingChecked)
+    {
+        this->blockSteppingChecked = true;
+        this->blockSteppingWorks = Tracee::probeBlockStepping();
+    }
+
+    if (blocks && !this->blockSteppingWorks)
+    {
+        cout << "Block steps do not stop on taken branches only (no branch trap flag?), tracing with single steps." << endl;
+        blocks = false;
+    }
+
+    //Enable the tracing:
+    this->tracer.setTracingActive(true);
+    this->blockTracing = blocks;
+    this->steppedSyscall = false;
+
+    //Disable the prompt, enable the loop:
+    setShowPrompt(false);
+    setKeepLooping(true);
+
+    //Initiate by performing a single resp. block step:
+    if (blocks)
+    {
+        this->blockStart = this->tracee.getRegisters().REG_IP;
+        performBlockStep();
+    }
+    else
+    {
+        this->tracee.performStep();
+    }
 }
 
 
@@ -161,6 +450,14 @@ void DebugLoop::handleExit(int exitCode)
 {
     cout << "Debugged process exited with code " << exitCode << "." << endl;
 
+    //Finish a running trace:
+    if (this->tracer.getTracingActive() && this->blockTracing)
+    {
+        finishBlockTrace();
+    }
+
+    stopTrace();
+
     //Stop the looping:
     setKeepLooping(false);
 }
@@ -184,18 +481,66 @@ void DebugLoop::handleStop(int signal)
     bool breakpointsWereInstalled = this->breakpointsInstalled;
     setBreakpointsInstalled(false);
 
-    //Are we tracing and is this a SIGTRAP?
-    if ((this->tracer.getTracingActive()) && (this->tracer.getTracingMode() != TRACING_MODE_NONE) && (this->stopSignal == SIGTRAP))
+    //Did we step over the library breakpoint?
+    if (this->steppingOverLibraryBreakpoint)
+    {
+        this->steppingOverLibraryBreakpoint = false;
+
+        if (this->stopSignal == SIGTRAP)
+        {
+            //Re-Install the breakpoints and go on:
+            setBreakpointsInstalled(true);
+            this->tracee.continueProcess(0);
+
+            return;
+        }
+    }
+
+    //Did the dynamic linker report a change of the shared objects?
+    if (breakpointsWereInstalled && this->libraryBreakpoint && (this->stopSignal == SIGTRAP) && (this->tracee.getRegisters().REG_IP - BREAKPOINT_INSTRUCTION_BYTES == (word)this->libraryBreakpoint->getAddress()))
     {
-        //Perform the tracing itself:
-        performTrace();
+        //Reset IP:
+        struct user_regs_struct registers = this->tracee.getRegisters();
+        registers.REG_IP = (word)this->libraryBreakpoint->getAddress();
+        this->tracee.setRegisters(registers);
+        this->tracee.updateRegisters();
 
-        //Do the next single step:
+        //Load the new ones only:
+        updateSharedObjects();
+
+        //Step over the original instruction and continue after that:
+        this->steppingOverLibraryBreakpoint = true;
         this->tracee.performStep();
 
         return;
     }
 
+    //Steps don't hit the library breakpoint, so the dynamic linker's notification is recognized by its address then:
+    word libraryAddress = this->tracee.getSharedObjects().getBreakpointAddress();
+
+    if (!breakpointsWereInstalled && libraryAddress && (this->stopSignal == SIGTRAP) && (this->tracee.getRegisters().REG_IP == libraryAddress))
+    {
+        updateSharedObjects();
+    }
+
+    //Are we tracing and is this a SIGTRAP?
+    if ((this->tracer.getTracingActive()) && (this->tracer.getTracingMode() != TRACING_MODE_NONE) && (this->stopSignal == SIGTRAP))
+    {
+        //Perform the tracing itself and do the next step:
+        if (this->blockTracing)
+        {
+            performBlockTrace();
+            performBlockStep();
+        }
+        else
+        {
+            performTrace();
+            this->tracee.performStep();
+        }
+
+        return;
+    }
+
     //Is this a syscall stop while continuing?
     if (this->stopSignal == (SIGTRAP | 0x80))
     {
@@ -212,7 +557,13 @@ void DebugLoop::handleStop(int signal)
     }
 
     //Disable tracing when a signal appears:
-    this->tracer.setTracingActive(false);
+    stopTrace();
+
+    //Right after exec the list of loaded objects is still empty, so try again until the dynamic linker has run:
+    if (!this->tracee.getSharedObjects().isListAvailable())
+    {
+        updateSharedObjects();
+    }
 
     //Show the signal that stopped us:
     cout << "Debugged process has received signal: " << strsignal(signal) << "." << endl;
@@ -226,7 +577,7 @@ void DebugLoop::handleStop(int signal)
     }
 
     //Disassemble one instruction:
-    cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << this->tracee.getRegisters().REG_IP << dec << ">\t" << this->tracee.disassemble(false).getAssemblyString() << endl;
+    cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << this->tracee.getRegisters().REG_IP << dec << ">\t" << this->tracee.disassemble(false).getAssembly() << endl;
 
     //Show a prompt on stop:
     setShowPrompt(true);
@@ -245,9 +596,64 @@ void DebugLoop::handleContinue()
 }
 
 
+void DebugLoop::handleStatic()
+{
+    cout << "Static mode: there is no process, only the mapped binary." << endl;
+
+    //Disassemble one instruction at the entry point:
+    cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << this->tracee.getRegisters().REG_IP << dec << ">\t" << this->tracee.disassemble(false).getAssembly() << endl;
+
+    //Prompt until exit:
+    setShowPrompt(true);
+
+    do
+    {
+        prompt();
+    } while (this->showPrompt && this->keepLooping);
+}
+
+
+void DebugLoop::updateMemoryMap(word result)
+{
+    MemoryMap& memoryMap = this->tracee.getMemoryMap();
+
+    //Failed calls return -errno and change nothing (brk returns the old break on failure, that's fine):
+    if (result > (word)-4096)
+    {
+        return;
+    }
+
+    switch (this->syscallNumber)
+    {
+#ifdef __i386__
+    //The old mmap takes a struct, the new one counts the offset in pages:
+    case SYSCALL_MMAP: memoryMap.invalidate(); break;
+    case SYSCALL_MMAP2: memoryMap.addMapping(result, this->syscallArgs[1], this->syscallArgs[2], this->syscallArgs[3], (int)this->syscallArgs[4], this->syscallArgs[5] * PAGE_SIZE_BYTES); break;
+#elif __amd64__
+    case SYSCALL_MMAP: memoryMap.addMapping(result, this->syscallArgs[1], this->syscallArgs[2], this->syscallArgs[3], (int)this->syscallArgs[4], this->syscallArgs[5]); break;
+#endif
+    case SYSCALL_MUNMAP: memoryMap.removeMapping(this->syscallArgs[0], this->syscallArgs[1]); break;
+    case SYSCALL_MPROTECT: memoryMap.protectMapping(this->syscallArgs[0], this->syscallArgs[1], this->syscallArgs[2]); break;
+    case SYSCALL_BRK: memoryMap.setBreak(result); break;
+
+    //Everything may have changed:
+    case SYSCALL_EXECVE:
+    case SYSCALL_MREMAP: memoryMap.invalidate(); break;
+    }
+}
+
+
 void DebugLoop::handleSyscall(word result)
 {
-    UNUSED(result);
+    //Keep the memory map up to date:
+    updateMemoryMap(result);
+
+    //The mappings may have changed. Previously decoded code may be stale now and the binary may have moved (that's recomputed lazily):
+    if (changesMappings(this->syscallNumber))
+    {
+        this->tracee.invalidateDecodeCache();
+        this->tracee.invalidateLoadBias();
+    }
 
     //Hook ptrace:
     if (this->syscallNumber == SYSCALL_PTRACE)
@@ -301,7 +707,10 @@ void DebugLoop::prompt()
         setShowPrompt(false);
         setKeepLooping(false);
 
-        this->tracee.detachFromProcess(0);
+        if (!this->tracee.isStatic())
+        {
+            this->tracee.detachFromProcess(0);
+        }
 
         return;
     }
@@ -324,6 +733,15 @@ void DebugLoop::prompt()
     //Handle:
     if (this->commands.find(commandStr) != this->commands.end())
     {
+        //Most commands need a process:
+        if (this->tracee.isStatic() && !this->commands[commandStr]->isStaticCapable())
+        {
+            cout << "This command needs a running process." << endl;
+            setShowPrompt(true);
+
+            return;
+        }
+
         this->commands[commandStr]->invoke(*this, args);
     }
     else
@@ -335,10 +753,10 @@ void DebugLoop::prompt()
 
 
 DebugLoop::DebugLoop(Tracee& tracee)
-    : tracee(tracee), initialized(false), syscallActive(false), syscallNumber(0), keepLooping(false), showPrompt(false), stopSignal(0), breakpointsInstalled(false)
+    : tracee(tracee), initialized(false), syscallActive(false), syscallNumber(0), keepLooping(false), showPrompt(false), stopSignal(0), breakpointsInstalled(false), libraryBreakpoint(NULL), steppingOverLibraryBreakpoint(false), blockTracing(false), blockStart(0), ambiguousBlocks(0), blockSteppingChecked(false), blockSteppingWorks(false), steppedSyscall(false)
 {
     //Load all our commands:
-    vector<Command*> commands = vector<Command*>({ new CommandBreakpoint(), new CommandContinue(), new CommandDetach(), new CommandDisassemble(), new CommandExit(), new CommandObfuscate(), new CommandRegisters(), new CommandStack(), new CommandStep(), new CommandTracer() });
+    vector<Command*> commands = vector<Command*>({ new CommandBreakpoint(), new CommandContinue(), new CommandDetach(), new CommandDisassemble(), new CommandExit(), new CommandMemory(), new CommandObfuscate(), new CommandRegisters(), new CommandStack(), new CommandStep(), new CommandTracer() });
 
     for (vector<Command*>::iterator it = commands.begin(); it != commands.end(); ++it)
     {
@@ -364,6 +782,9 @@ DebugLoop::~DebugLoop()
 
     this->breakpoints.clear();
 
+    delete this->libraryBreakpoint;
+    this->libraryBreakpoint = NULL;
+
     //Free (only the distinct) commands:
     set<Command*> ptrs;
 
@@ -385,6 +806,15 @@ void DebugLoop::loop()
     //Start with looping:
     setKeepLooping(true);
 
+    //Without a process there are no signals to wait for:
+    if (this->tracee.isStatic())
+    {
+        handleStatic();
+        cout << "The debug loop has been left." << endl;
+
+        return;
+    }
+
     do
     {
         //Wait for stop or exit:
@@ -414,6 +844,12 @@ void DebugLoop::addBreakpoint(pword address)
         }
     }
 
+    //The library breakpoint is in use already:
+    if (this->libraryBreakpoint && (((word)address - (word)this->libraryBreakpoint->getAddress()) < BREAKPOINT_INSTRUCTION_BYTES))
+    {
+        throw runtime_error("The new breakpoint would collide with the shared library breakpoint.");
+    }
+
     //Allocate the new breakpoint:
     Breakpoint* breakpoint = new Breakpoint(this->tracee, address);
 
@@ -456,6 +892,56 @@ void DebugLoop::setBreakpointsInstalled(bool flag)
         }
     }
 
+    //The library breakpoint (it's not in the map):
+    if (this->libraryBreakpoint)
+    {
+        try
+        {
+            this->libraryBreakpoint->setInstalled(flag);
+        }
+        catch (...)
+        {
+            //No notifications then.
+        }
+    }
+
     //Mark:
     this->breakpointsInstalled = flag;
 }
+
+
+int DebugLoop::writeMemory(pword address, int count, const byte* ptr)
+{
+    //Breakpoints are deinstalled at the prompt, so the written bytes become their originals:
+    int total = this->tracee.writeMemory(address, count, ptr);
+
+    for (map<pword, Breakpoint*>::iterator it = this->breakpoints.begin(); it != this->breakpoints.end(); ++it)
+    {
+        it->second->updateData(address, total, ptr);
+    }
+
+    if (this->libraryBreakpoint)
+    {
+        this->libraryBreakpoint->updateData(address, total, ptr);
+    }
+
+    return total;
+}
+
+
+void DebugLoop::quiesceThreads()
+{
+    //The symbol table is loaded on a thread of its own:
+    this->tracee.getSymbolTable();
+
+    //The thread pools park their workers:
+    this->tracee.getSharedObjects().waitIdle();
+
+    for (map<string, Command*>::iterator it = this->commands.begin(); it != this->commands.end(); ++it)
+    {
+        it->second->waitIdle();
+    }
+
+    //The trace writer sleeps once everything is written:
+    this->tracer.flush();
+}
@@ -13,6 +13,9 @@
 
 #define DEFAULT_PROMPT "(ldb)"
 
+//The max number of instructions walked from the start of a block to its taken branch:
+#define MAX_TRACE_BLOCK_INSTRUCTIONS 65536
+
 using namespace std;
 
 class Command;
@@ -60,9 +63,28 @@ private:
     bool breakpointsInstalled;
     map<pword, Breakpoint*> breakpoints;
 
+    //The internal breakpoint reporting loaded/unloaded shared objects (NULL if there is none).
+    //Unlike the user's ones it stays and is stepped over:
+    Breakpoint* libraryBreakpoint;
+    bool steppingOverLibraryBreakpoint;
+
     //The runtime tracer:
     Tracer tracer;
 
+    //Tracing with block steps: are they used and where did the running block start?
+    bool blockTracing;
+    word blockStart;
+
+    //The number of blocks that could have ended at more than one branch (reported when the trace stops):
+    word ambiguousBlocks;
+
+    //Does the CPU stop on taken branches only (probed once, the branch trap flag is missing in some VMs)?
+    bool blockSteppingChecked;
+    bool blockSteppingWorks;
+
+    //Did the last traced step execute an instruction entering the kernel?
+    bool steppedSyscall;
+
     //Our commands:
     map<string, Command*> commands;
 
@@ -80,9 +102,27 @@ private:
     //Initialize:
     void performInitialization();
 
+    //Load the symbols of new shared objects and move the library breakpoint if necessary:
+    void updateSharedObjects();
+
+    //Drop the decoded code if a syscall that was stepped over may have changed the mappings:
+    void checkSteppedSyscall();
+
     //Trace the current mnemonic:
     void performTrace();
 
+    //Trace the instructions of the block that ended with the current stop:
+    void performBlockTrace();
+
+    //Trace the rest of the block the process has exited in:
+    void finishBlockTrace();
+
+    //Run to the next taken branch (single step if that is not supported):
+    void performBlockStep();
+
+    //Stop tracing (and tell about the ambiguous blocks):
+    void stopTrace();
+
     //Handle SIGTRAP | 0x80:
     void performSyscall();
 
@@ -95,9 +135,15 @@ private:
     void handleStop(int signal);
     void handleContinue();
 
+    //Handle static mode (there is no process, so we only prompt):
+    void handleStatic();
+
     //Handle a syscall:
     void handleSyscall(word result);
 
+    //Follow the mapping changes of a finished syscall in the memory map:
+    void updateMemoryMap(word result);
+
     //Show a prompt to the user to question a command:
     void prompt();
 
@@ -115,6 +161,9 @@ public:
     //Get the last stop signal:
     inline int getStopSignal() const { return this->stopSignal; }
 
+    //Start tracing with single steps resp. block steps:
+    void startTrace(bool blocks);
+
     //Set our intern runtime flags:
     inline void setKeepLooping(bool flag) { this->keepLooping = flag; }
     inline void setShowPrompt(bool flag) { this->showPrompt = flag; }
@@ -140,6 +189,13 @@ public:
 
     //Install/Deinstall breakpoints:
     void setBreakpointsInstalled(bool flag);
+
+    //Write memory of the tracee (like Tracee::writeMemory()) and keep the original bytes of the breakpoints in it:
+    int writeMemory(pword address, int count, const byte* ptr);
+
+    //Let our own threads finish their work before forking helper processes.
+    //Afterwards none of them is in the middle of something a forked child could inherit half done:
+    void quiesceThreads();
 };
 
 #endif // DEBUGLOOP_H
@@ -0,0 +1,141 @@
+#include "Disassembler.hpp"
+
+#define PACKAGE 1
+#define PACKAGE_VERSION 1
+#include <bfd.h>
+
+#include <dis-asm.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+int Disassembler::appendText(void* stream, const char* format, ...)
+{
+    Disassembler* disassembler = (Disassembler*)stream;
+
+    //Is there space left?
+    int space = MAX_ASSEMBLY_LENGTH - disassembler->textLength;
+
+    if (space <= 1)
+    {
+        return 0;
+    }
+
+    //Format directly into the text buffer:
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(disassembler->text + disassembler->textLength, space, format, args);
+    va_end(args);
+
+    //Advance (the output may have been truncated):
+    if (written > 0)
+    {
+        disassembler->textLength += (written < space) ? written : (space - 1);
+    }
+
+    return written;
+}
+
+
+int Disassembler::discardText(void* stream, const char* format, ...)
+{
+    UNUSED(stream);
+    UNUSED(format);
+
+    return 0;
+}
+
+
+int Disassembler::run(struct disassemble_info* info, const byte* buffer, int length, bool att)
+{
+    //This is the same for all architectures:
+    info->buffer = (bfd_byte*)buffer;
+    info->buffer_length = length;
+
+    //Start with an empty text:
+    this->textLength = 0;
+    this->text[0] = 0;
+
+    //Discriminate between architectures:
+#ifdef __i386__
+    int result = att ? print_insn_i386(0, info) : print_insn_i386_intel(0, info);
+#elif __amd64__
+    int result = att ? print_insn_i386(0, info) : print_insn_i386_intel(0, info);
+#endif
+
+    //Not decodable at all (e.g. the buffer ends within the instruction):
+    if (result <= 0)
+    {
+        return 0;
+    }
+
+    return result;
+}
+
+
+Disassembler::Disassembler()
+    : intelInfo(NULL), attInfo(NULL), textLength(0)
+{
+    this->text[0] = 0;
+
+    //Prepare disassembly info (bfd) once for both flavors:
+    this->intelInfo = new disassemble_info;
+    this->attInfo = new disassemble_info;
+
+    init_disassemble_info(this->intelInfo, this, (fprintf_ftype)appendText);
+    init_disassemble_info(this->attInfo, this, (fprintf_ftype)appendText);
+
+    //Discriminate between architectures:
+#ifdef __i386__
+    this->intelInfo->arch = bfd_arch_i386;
+    this->intelInfo->mach = bfd_mach_i386_i386_intel_syntax;
+    this->attInfo->arch = bfd_arch_i386;
+    this->attInfo->mach = bfd_mach_i386_i386;
+#elif __amd64__
+    this->intelInfo->arch = bfd_arch_i386;
+    this->intelInfo->mach = bfd_mach_x86_64_intel_syntax;
+    this->attInfo->arch = bfd_arch_i386;
+    this->attInfo->mach = bfd_mach_x86_64;
+#endif
+
+    this->intelInfo->endian = BFD_ENDIAN_LITTLE;
+    this->attInfo->endian = BFD_ENDIAN_LITTLE;
+}
+
+
+Disassembler::~Disassembler()
+{
+    delete this->intelInfo;
+    delete this->attInfo;
+}
+
+
+Mnemonic Disassembler::decode(const byte* buffer, int length, bool att)
+{
+    int opcodeLength = run(att ? this->attInfo : this->intelInfo, buffer, length, att);
+
+    //Treat undecodable bytes as a single bad byte, so callers always make progress:
+    if (opcodeLength == 0)
+    {
+        return Mnemonic(buffer, (length > 0) ? 1 : 0, "(bad)", 5);
+    }
+
+    return Mnemonic(buffer, opcodeLength, this->text, this->textLength);
+}
+
+
+int Disassembler::decodeLength(const byte* buffer, int length)
+{
+    //Drop the text while decoding:
+    this->intelInfo->fprintf_func = (fprintf_ftype)discardText;
+    int opcodeLength = run(this->intelInfo, buffer, length, false);
+    this->intelInfo->fprintf_func = (fprintf_ftype)appendText;
+
+    //Same as above:
+    if ((opcodeLength == 0) && (length > 0))
+    {
+        return 1;
+    }
+
+    return opcodeLength;
+}
@@ -0,0 +1,56 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include "Globals.hpp"
+#include "Mnemonic.hpp"
+
+using namespace std;
+
+//From libopcodes (dis-asm.h), only used through pointers here:
+struct disassemble_info;
+
+class Disassembler
+{
+    //Members:
+private:
+
+    //The libopcodes state for both flavors.
+    //It is initialized once and reused for every instruction:
+    struct disassemble_info* intelInfo;
+    struct disassemble_info* attInfo;
+
+    //The text the print callback has written so far (no allocations, no streams):
+    char text[MAX_ASSEMBLY_LENGTH];
+    int textLength;
+
+    //Methods:
+private:
+
+    //The print callbacks handed to libopcodes.
+    //The first one appends to the text buffer, the second one drops everything (length-only decoding):
+    static int appendText(void* stream, const char* format, ...);
+    static int discardText(void* stream, const char* format, ...);
+
+    //Run libopcodes on a buffer and return the opcode length:
+    int run(struct disassemble_info* info, const byte* buffer, int length, bool att);
+
+public:
+
+    //Constructor:
+    Disassembler();
+
+    //Not copyable (libopcodes holds a pointer to this instance):
+    Disassembler(const Disassembler&) = delete;
+    Disassembler& operator=(const Disassembler&) = delete;
+
+    //Destructor:
+    virtual ~Disassembler();
+
+    //Decode one instruction including its assembly text:
+    Mnemonic decode(const byte* buffer, int length, bool att);
+
+    //Only decode the length of one instruction (no text is formatted at all):
+    int decodeLength(const byte* buffer, int length);
+};
+
+#endif // DISASSEMBLER_H
@@ -0,0 +1,341 @@
+#include "ElfImage.hpp"
+
+#include <algorithm>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//The ELF class matching our architecture:
+#ifdef __i386__
+#define ELF_NATIVE_CLASS ELFCLASS32
+#define ELF_NATIVE_MACHINE EM_386
+#elif __amd64__
+#define ELF_NATIVE_CLASS ELFCLASS64
+#define ELF_NATIVE_MACHINE EM_X86_64
+#endif
+
+ElfImage::ElfImage(string path)
+    : path(path), data(NULL), size(0), entry(0)
+{
+    //Open the file:
+    int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file < 0)
+    {
+        throw runtime_error(string("Failed to open binary file (open error code: ") + strerror(errno) + ").");
+    }
+
+    //Get its size:
+    struct stat status;
+
+    if (fstat(file, &status))
+    {
+        close(file);
+        throw runtime_error(string("Failed to get the binary file size (fstat error code: ") + strerror(errno) + ").");
+    }
+
+    this->size = status.st_size;
+
+    if (this->size < sizeof(ElfW(Ehdr)))
+    {
+        close(file);
+        throw runtime_error("The binary file is too small to be an ELF file.");
+    }
+
+    //Map it (the mapping stays valid after closing the file):
+    void* mapping = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw runtime_error(string("Failed to map the binary file (mmap error code: ") + strerror(errno) + ").");
+    }
+
+    this->data = (pbyte)mapping;
+
+    //Parse the headers:
+    try
+    {
+        parse();
+    }
+    catch (...)
+    {
+        munmap(this->data, this->size);
+        this->data = NULL;
+
+        throw;
+    }
+}
+
+
+ElfImage::~ElfImage()
+{
+    //Unmap the file:
+    if (this->data)
+    {
+        munmap(this->data, this->size);
+        this->data = NULL;
+    }
+}
+
+
+void ElfImage::parse()
+{
+    const ElfW(Ehdr)* header = (const ElfW(Ehdr)*)this->data;
+
+    //Check the identification:
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG))
+    {
+        throw runtime_error("The binary is no ELF file.");
+    }
+
+    if ((header->e_ident[EI_CLASS] != ELF_NATIVE_CLASS) || (header->e_ident[EI_DATA] != ELFDATA2LSB) || (header->e_machine != ELF_NATIVE_MACHINE))
+    {
+        throw runtime_error("The binary has been built for another architecture.");
+    }
+
+    //The program header table must be inside the file:
+    if ((header->e_phentsize != sizeof(ElfW(Phdr))) || (header->e_phoff > this->size) || ((header->e_phnum * sizeof(ElfW(Phdr))) > (this->size - header->e_phoff)))
+    {
+        throw runtime_error("The program header table of the binary is malformed.");
+    }
+
+    this->entry = header->e_entry;
+
+    //Collect the loadable segments:
+    const ElfW(Phdr)* programHeaders = (const ElfW(Phdr)*)(this->data + header->e_phoff);
+
+    for (int i = 0; i < header->e_phnum; i++)
+    {
+        //Notes (the build-id):
+        if ((programHeaders[i].p_type == PT_NOTE) && (programHeaders[i].p_offset <= this->size) && (programHeaders[i].p_filesz <= (this->size - programHeaders[i].p_offset)))
+        {
+            parseNotes(programHeaders[i].p_offset, programHeaders[i].p_filesz);
+        }
+
+        if (programHeaders[i].p_type != PT_LOAD)
+        {
+            continue;
+        }
+
+        //The file part must be inside the file:
+        if ((programHeaders[i].p_offset > this->size) || (programHeaders[i].p_filesz > (this->size - programHeaders[i].p_offset)))
+        {
+            throw runtime_error("A loadable segment of the binary exceeds the file.");
+        }
+
+        ElfImageSegment segment;
+        segment.address = programHeaders[i].p_vaddr;
+        segment.memorySize = programHeaders[i].p_memsz;
+        segment.fileOffset = programHeaders[i].p_offset;
+        segment.fileSize = min(programHeaders[i].p_filesz, programHeaders[i].p_memsz);
+
+        this->segments.push_back(segment);
+    }
+
+    //Sort by address:
+    sort(this->segments.begin(), this->segments.end(), [](const ElfImageSegment& a, const ElfImageSegment& b) { return a.address < b.address; });
+}
+
+
+void ElfImage::parseNotes(word offset, word size)
+{
+    word position = 0;
+
+    //Every note is a header followed by the name and the description, both padded to 4 bytes:
+    while ((size - position) >= sizeof(ElfW(Nhdr)))
+    {
+        const ElfW(Nhdr)* note = (const ElfW(Nhdr)*)(this->data + offset + position);
+        word nameSize = (note->n_namesz + 3) & ~3UL;
+        word descriptionSize = (note->n_descsz + 3) & ~3UL;
+
+        if ((nameSize + descriptionSize) > (size - position - sizeof(ElfW(Nhdr))))
+        {
+            return;
+        }
+
+        const char* name = (const char*)(note + 1);
+        const byte* description = (const byte*)(name + nameSize);
+
+        if ((note->n_type == NT_GNU_BUILD_ID) && (note->n_namesz == 4) && !memcmp(name, "GNU", 4))
+        {
+            static const char digits[] = "0123456789abcdef";
+            this->buildId.clear();
+
+            for (unsigned int i = 0; i < note->n_descsz; i++)
+            {
+                this->buildId += digits[description[i] >> 4];
+                this->buildId += digits[description[i] & 0xf];
+            }
+
+            return;
+        }
+
+        position += sizeof(ElfW(Nhdr)) + nameSize + descriptionSize;
+    }
+}
+
+
+const ElfImageSegment* ElfImage::findSegment(word address) const
+{
+    //There are only a few segments:
+    for (vector<ElfImageSegment>::const_iterator it = this->segments.begin(); it != this->segments.end(); ++it)
+    {
+        if ((address >= it->address) && ((address - it->address) < it->memorySize))
+        {
+            return &(*it);
+        }
+    }
+
+    return NULL;
+}
+
+
+const void* ElfImage::getSectionHeaders(int& count, const char*& names, word& namesSize) const
+{
+    const ElfW(Ehdr)* header = (const ElfW(Ehdr)*)this->data;
+
+    count = 0;
+    names = NULL;
+    namesSize = 0;
+
+    //The section header table must be inside the file:
+    if ((header->e_shoff == 0) || (header->e_shentsize != sizeof(ElfW(Shdr))) || (header->e_shoff > this->size) || ((header->e_shnum * sizeof(ElfW(Shdr))) > (this->size - header->e_shoff)))
+    {
+        return NULL;
+    }
+
+    const ElfW(Shdr)* sectionHeaders = (const ElfW(Shdr)*)(this->data + header->e_shoff);
+    count = header->e_shnum;
+
+    //The section name table must be inside the file as well:
+    if (header->e_shstrndx < header->e_shnum)
+    {
+        const ElfW(Shdr)* nameSection = &sectionHeaders[header->e_shstrndx];
+
+        if ((nameSection->sh_offset <= this->size) && (nameSection->sh_size <= (this->size - nameSection->sh_offset)))
+        {
+            names = (const char*)(this->data + nameSection->sh_offset);
+            namesSize = nameSection->sh_size;
+        }
+    }
+
+    return sectionHeaders;
+}
+
+
+bool ElfImage::findSection(const string& name, word& address, word& size) const
+{
+    int count = 0;
+    const char* names = NULL;
+    word namesSize = 0;
+    const ElfW(Shdr)* sectionHeaders = (const ElfW(Shdr)*)getSectionHeaders(count, names, namesSize);
+
+    if (!sectionHeaders || !names)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        //Only sections present in memory:
+        if (!(sectionHeaders[i].sh_flags & SHF_ALLOC) || (sectionHeaders[i].sh_name >= namesSize))
+        {
+            continue;
+        }
+
+        //Compare the name (it must be terminated within the table):
+        const char* sectionName = names + sectionHeaders[i].sh_name;
+
+        if ((name.size() < (namesSize - sectionHeaders[i].sh_name)) && !strncmp(sectionName, name.c_str(), name.size() + 1))
+        {
+            address = sectionHeaders[i].sh_addr;
+            size = sectionHeaders[i].sh_size;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+vector<ElfImageSymbolSection> ElfImage::getSymbolSections() const
+{
+    vector<ElfImageSymbolSection> symbolSections;
+    int count = 0;
+    const char* names = NULL;
+    word namesSize = 0;
+    const ElfW(Shdr)* sectionHeaders = (const ElfW(Shdr)*)getSectionHeaders(count, names, namesSize);
+
+    if (!sectionHeaders)
+    {
+        return symbolSections;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const ElfW(Shdr)& section = sectionHeaders[i];
+
+        if (((section.sh_type != SHT_SYMTAB) && (section.sh_type != SHT_DYNSYM)) || (section.sh_entsize != sizeof(ElfW(Sym))) || (section.sh_link >= (unsigned int)count))
+        {
+            continue;
+        }
+
+        //The symbols and their strings must be inside the file:
+        const ElfW(Shdr)& strings = sectionHeaders[section.sh_link];
+
+        if ((section.sh_offset > this->size) || (section.sh_size > (this->size - section.sh_offset)) || (strings.sh_offset > this->size) || (strings.sh_size > (this->size - strings.sh_offset)))
+        {
+            continue;
+        }
+
+        ElfImageSymbolSection symbolSection;
+        symbolSection.symbols = this->data + section.sh_offset;
+        symbolSection.count = section.sh_size / sizeof(ElfW(Sym));
+        symbolSection.stringsOffset = strings.sh_offset;
+        symbolSection.stringsSize = strings.sh_size;
+        symbolSection.dynamic = (section.sh_type == SHT_DYNSYM);
+
+        //The dynamic one first, so the full table wins for names in both:
+        symbolSections.insert(symbolSection.dynamic ? symbolSections.begin() : symbolSections.end(), symbolSection);
+    }
+
+    return symbolSections;
+}
+
+
+int ElfImage::read(word address, int count, byte* ptr) const
+{
+    int total = 0;
+
+    while (total < count)
+    {
+        //Find the segment of the current address:
+        word current = address + total;
+        const ElfImageSegment* segment = findSegment(current);
+
+        if (!segment)
+        {
+            break;
+        }
+
+        word offset = current - segment->address;
+        int length = (int)min((word)(count - total), segment->memorySize - offset);
+
+        //Copy the part backed by the file, the rest (e.g. .bss) is zero:
+        int fileLength = (offset < segment->fileSize) ? (int)min((word)length, segment->fileSize - offset) : 0;
+
+        memcpy(ptr + total, this->data + segment->fileOffset + offset, fileLength);
+        memset(ptr + total + fileLength, 0, length - fileLength);
+
+        total += length;
+    }
+
+    return total;
+}
@@ -0,0 +1,105 @@
+#ifndef ELFIMAGE_H
+#define ELFIMAGE_H
+
+#include <string>
+#include <vector>
+
+#include "Globals.hpp"
+
+using namespace std;
+
+//A loadable segment (PT_LOAD) of the image:
+struct ElfImageSegment
+{
+    //The virtual address and size in memory:
+    word address;
+    word memorySize;
+
+    //The location and size in the file (the remaining memory part is zero filled):
+    word fileOffset;
+    word fileSize;
+};
+
+//A symbol table section (.symtab or .dynsym) of the image:
+struct ElfImageSymbolSection
+{
+    //The symbols (ElfW(Sym) entries) and their number:
+    const void* symbols;
+    word count;
+
+    //The location of the string table within the file:
+    word stringsOffset;
+    word stringsSize;
+
+    //Is it the dynamic symbol table?
+    bool dynamic;
+};
+
+class ElfImage
+{
+    //Members:
+private:
+
+    //The path of the file:
+    string path;
+
+    //The mapped file:
+    pbyte data;
+    word size;
+
+    //The entry point:
+    word entry;
+
+    //The build-id as hex string (empty if there is none):
+    string buildId;
+
+    //The loadable segments, sorted by address:
+    vector<ElfImageSegment> segments;
+
+    //Methods:
+private:
+
+    //Parse the headers (called by the constructor):
+    void parse();
+
+    //Parse a note segment and take over the build-id if there is one:
+    void parseNotes(word offset, word size);
+
+    //Find the segment containing an address (NULL if there is none):
+    const ElfImageSegment* findSegment(word address) const;
+
+    //Get the section header table (NULL if there is none) and the section name table:
+    const void* getSectionHeaders(int& count, const char*& names, word& namesSize) const;
+
+public:
+
+    //Getters:
+    inline const string& getPath() const { return this->path; }
+    inline const byte* getData() const { return this->data; }
+    inline word getSize() const { return this->size; }
+    inline word getEntry() const { return this->entry; }
+    inline const string& getBuildId() const { return this->buildId; }
+    inline const vector<ElfImageSegment>& getSegments() const { return this->segments; }
+
+    //Constructor (maps the file, throws an exception if it is no valid ELF file for this architecture):
+    ElfImage(string path);
+
+    //Not copyable (it owns the mapping):
+    ElfImage(const ElfImage&) = delete;
+    ElfImage& operator=(const ElfImage&) = delete;
+
+    //Destructor:
+    virtual ~ElfImage();
+
+    //Read the memory image at a virtual address (like the loader would map it).
+    //This returns the number of bytes read, which is less than count if an unmapped address has been hit:
+    int read(word address, int count, byte* ptr) const;
+
+    //Find an allocated section by name and get its virtual address and size:
+    bool findSection(const string& name, word& address, word& size) const;
+
+    //Get the symbol table sections (the dynamic one first):
+    vector<ElfImageSymbolSection> getSymbolSections() const;
+};
+
+#endif // ELFIMAGE_H
@@ -1,5 +1,7 @@
 #include "Globals.hpp"
 
+#include <sys/user.h>
+
 //The breakpoint instruction.
 //Padded to word size with 0x00s, the "dead bytes" ...
 #ifdef __i386__
@@ -7,3 +9,13 @@ word breakpointInstruction[MAX_BREAKPOINT_INSTRUCTION_WORDS] = { 0xCC };
 #elif __amd64__
 word breakpointInstruction[MAX_BREAKPOINT_INSTRUCTION_WORDS] = { 0xCC };
 #endif
+
+//The registers in the order of struct user_regs_struct:
+#ifdef __i386__
+const char* registerNames[REGISTER_COUNT] = { "ebx", "ecx", "edx", "esi", "edi", "ebp", "eax", "ds", "es", "fs", "gs", "orig_eax", "eip", "cs", "eflags", "esp", "ss" };
+#elif __amd64__
+const char* registerNames[REGISTER_COUNT] = { "r15", "r14", "r13", "r12", "rbp", "rbx", "r11", "r10", "r9", "r8", "rax", "rcx", "rdx", "rsi", "rdi", "orig_rax", "rip", "cs", "eflags", "rsp", "ss", "fs_base", "gs_base", "ds", "es", "fs", "gs" };
+#endif
+
+//The names must cover the whole struct:
+static_assert(sizeof(struct user_regs_struct) == REGISTER_COUNT * sizeof(word), "REGISTER_COUNT does not match struct user_regs_struct.");
@@ -27,6 +27,13 @@ typedef unsigned long word, *pword;
 //How many words are needed to cover one instruction?
 #define MAX_INSTRUCTION_WORDS ((int)(((MAX_INSTRUCTION_BYTES - 1) / WORD_SIZE_BYTES) + 1))
 
+//The size of a memory page:
+#ifdef __i386__
+#define PAGE_SIZE_BYTES ((int)4096)
+#elif __amd64__
+#define PAGE_SIZE_BYTES ((int)4096)
+#endif
+
 //The breakpoint instruction:
 #ifdef __i386__
 #define BREAKPOINT_INSTRUCTION_BYTES 1
@@ -64,13 +71,36 @@ extern word breakpointInstruction[MAX_BREAKPOINT_INSTRUCTION_WORDS];
 #define REG_FG eflags
 #endif
 
+//The number of words in struct user_regs_struct:
+#ifdef __i386__
+#define REGISTER_COUNT 17
+#elif __amd64__
+#define REGISTER_COUNT 27
+#endif
+
+//The names of these words (in the order of the struct):
+extern const char* registerNames[REGISTER_COUNT];
+
 //Some system calls:
 #ifdef __i386__
 #define SYSCALL_PTRACE 26
 #define SYSCALL_TIME 13
+#define SYSCALL_EXECVE 11
+#define SYSCALL_MMAP 90
+#define SYSCALL_MMAP2 192
+#define SYSCALL_MUNMAP 91
+#define SYSCALL_MPROTECT 125
+#define SYSCALL_MREMAP 163
+#define SYSCALL_BRK 45
 #elif __amd64__
 #define SYSCALL_PTRACE 101
 #define SYSCALL_TIME 201
+#define SYSCALL_EXECVE 59
+#define SYSCALL_MMAP 9
+#define SYSCALL_MUNMAP 11
+#define SYSCALL_MPROTECT 10
+#define SYSCALL_MREMAP 25
+#define SYSCALL_BRK 12
 #endif
 
 #endif // TYPES_HPP
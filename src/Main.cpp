@@ -9,6 +9,7 @@
 #include "Tracee.hpp"
 #include "DebugLoop.hpp"
 #include "Globals.hpp"
+#include "TraceFile.hpp"
 
 using namespace std;
 
@@ -33,7 +34,31 @@ int main(int argc, char** argv)
     if (argc <= traceeArgOffset)
     {
         //TODO
-        cout << "Usage:\n\tldb run <path to binary> <binary arguments>\n\tldb attach <pid>" << endl;
+        cout << "Usage:\n\tldb run <path to binary> <binary arguments>\n\tldb attach <pid>\n\tldb static <path to binary>\n\tldb trace-dump <path to binary trace> [regs]" << endl;
+        return 0;
+    }
+
+    //Print a binary trace as text, optionally with the changed registers (no tracee needed):
+    if (string(argv[traceeArgOffset]) == "trace-dump")
+    {
+        if (argc <= traceeArgOffset + 1)
+        {
+            cout << "Please provide the path of a binary trace file." << endl;
+            return -1;
+        }
+
+        try
+        {
+            TraceFileReader reader(argv[traceeArgOffset + 1]);
+            reader.dump(cout, (argc > traceeArgOffset + 2) && (string(argv[traceeArgOffset + 2]) == "regs"));
+        }
+        catch (const runtime_error& rt)
+        {
+            cout.flush();
+            cerr << rt.what() << endl;
+            return -1;
+        }
+
         return 0;
     }
 
@@ -0,0 +1,289 @@
+#include "MemoryMap.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+//Compares the start of a region with an address:
+static bool compareRegionStart(word address, const MemoryRegion& region)
+{
+    return address < region.start;
+}
+
+
+MemoryMap::MemoryMap()
+    : pid(-1), valid(false)
+{
+
+}
+
+
+void MemoryMap::setPID(pid_t pid)
+{
+    this->pid = pid;
+    this->regions.clear();
+    this->valid = false;
+}
+
+
+void MemoryMap::parse()
+{
+    this->regions.clear();
+    this->valid = true;
+
+    if (this->pid <= 0)
+    {
+        return;
+    }
+
+    ifstream maps("/proc/" + to_string(this->pid) + "/maps");
+    string line;
+
+    //Every line looks like "<start>-<end> <perms> <offset> <dev> <inode> [<path>]":
+    while (getline(maps, line))
+    {
+        MemoryRegion region;
+        string permissions;
+        string device;
+        word inode = 0;
+        char separator;
+
+        istringstream stream(line);
+        stream >> hex >> region.start >> separator >> region.end >> permissions >> region.offset >> device >> dec >> inode;
+
+        if (stream.fail() || (permissions.size() < 4))
+        {
+            continue;
+        }
+
+        region.readable = (permissions[0] == 'r');
+        region.writable = (permissions[1] == 'w');
+        region.executable = (permissions[2] == 'x');
+        region.shared = (permissions[3] == 's');
+
+        //The rest of the line (paths may contain spaces):
+        getline(stream >> ws, region.path);
+
+        this->regions.push_back(region);
+    }
+}
+
+
+void MemoryMap::ensureValid()
+{
+    if (!this->valid)
+    {
+        parse();
+    }
+}
+
+
+void MemoryMap::removeRange(word start, word end)
+{
+    vector<MemoryRegion> result;
+    result.reserve(this->regions.size() + 1);
+
+    for (vector<MemoryRegion>::iterator it = this->regions.begin(); it != this->regions.end(); ++it)
+    {
+        //Not affected:
+        if ((it->end <= start) || (it->start >= end))
+        {
+            result.push_back(*it);
+            continue;
+        }
+
+        //Keep the parts in front of and behind the range:
+        if (it->start < start)
+        {
+            MemoryRegion head = *it;
+            head.end = start;
+
+            result.push_back(head);
+        }
+
+        if (it->end > end)
+        {
+            MemoryRegion tail = *it;
+            tail.offset += end - it->start;
+            tail.start = end;
+
+            result.push_back(tail);
+        }
+    }
+
+    this->regions.swap(result);
+}
+
+
+void MemoryMap::insertRegion(const MemoryRegion& region)
+{
+    removeRange(region.start, region.end);
+    this->regions.insert(upper_bound(this->regions.begin(), this->regions.end(), region.start, compareRegionStart), region);
+}
+
+
+const vector<MemoryRegion>& MemoryMap::getRegions()
+{
+    ensureValid();
+    return this->regions;
+}
+
+
+const MemoryRegion* MemoryMap::findRegion(word address)
+{
+    ensureValid();
+
+    //The last region starting at or before the address:
+    vector<MemoryRegion>::const_iterator it = upper_bound(this->regions.begin(), this->regions.end(), address, compareRegionStart);
+
+    if ((it == this->regions.begin()) || ((--it)->end <= address))
+    {
+        return NULL;
+    }
+
+    return &*it;
+}
+
+
+word MemoryMap::getMappedLength(word address, word count)
+{
+    //Without a process there is nothing to check:
+    if (this->pid <= 0)
+    {
+        return count;
+    }
+
+    ensureValid();
+
+    //The region containing the address:
+    vector<MemoryRegion>::const_iterator it = upper_bound(this->regions.begin(), this->regions.end(), address, compareRegionStart);
+
+    if ((it == this->regions.begin()) || ((--it)->end <= address))
+    {
+        return 0;
+    }
+
+    //Follow adjacent regions:
+    word end = it->end;
+
+    while (((end - address) < count) && (++it != this->regions.end()) && (it->start == end))
+    {
+        end = it->end;
+    }
+
+    return min(end - address, count);
+}
+
+
+void MemoryMap::addMapping(word address, word length, int protection, int flags, int fd, word offset)
+{
+    if (!this->valid || (length == 0))
+    {
+        return;
+    }
+
+    MemoryRegion region;
+    region.start = address;
+    region.end = address + ((length + PAGE_SIZE_BYTES - 1) & ~((word)PAGE_SIZE_BYTES - 1));
+    region.readable = (protection & PROT_READ);
+    region.writable = (protection & PROT_WRITE);
+    region.executable = (protection & PROT_EXEC);
+    region.shared = (flags & MAP_SHARED);
+    region.offset = (flags & MAP_ANONYMOUS) ? 0 : offset;
+
+    //The file behind the descriptor:
+    if (!(flags & MAP_ANONYMOUS) && (fd >= 0))
+    {
+        char path[PATH_MAX];
+        ssize_t pathLength = readlink(("/proc/" + to_string(this->pid) + "/fd/" + to_string(fd)).c_str(), path, sizeof(path) - 1);
+
+        if (pathLength > 0)
+        {
+            region.path.assign(path, pathLength);
+        }
+    }
+
+    insertRegion(region);
+}
+
+
+void MemoryMap::removeMapping(word address, word length)
+{
+    if (!this->valid || (length == 0))
+    {
+        return;
+    }
+
+    removeRange(address, address + ((length + PAGE_SIZE_BYTES - 1) & ~((word)PAGE_SIZE_BYTES - 1)));
+}
+
+
+void MemoryMap::protectMapping(word address, word length, int protection)
+{
+    if (!this->valid || (length == 0))
+    {
+        return;
+    }
+
+    word start = address;
+    word end = address + ((length + PAGE_SIZE_BYTES - 1) & ~((word)PAGE_SIZE_BYTES - 1));
+
+    //Collect the affected parts with their new protection:
+    vector<MemoryRegion> changed;
+
+    for (vector<MemoryRegion>::iterator it = this->regions.begin(); it != this->regions.end(); ++it)
+    {
+        if ((it->end <= start) || (it->start >= end))
+        {
+            continue;
+        }
+
+        MemoryRegion part = *it;
+        part.start = max(it->start, start);
+        part.end = min(it->end, end);
+        part.offset += part.start - it->start;
+        part.readable = (protection & PROT_READ);
+        part.writable = (protection & PROT_WRITE);
+        part.executable = (protection & PROT_EXEC);
+
+        changed.push_back(part);
+    }
+
+    for (vector<MemoryRegion>::iterator it = changed.begin(); it != changed.end(); ++it)
+    {
+        insertRegion(*it);
+    }
+}
+
+
+void MemoryMap::setBreak(word address)
+{
+    if (!this->valid)
+    {
+        return;
+    }
+
+    //Move the end of the heap:
+    for (vector<MemoryRegion>::iterator it = this->regions.begin(); it != this->regions.end(); ++it)
+    {
+        if (it->path == "[heap]")
+        {
+            word end = (address + PAGE_SIZE_BYTES - 1) & ~((word)PAGE_SIZE_BYTES - 1);
+
+            //Don't run into the next region (the break can't either):
+            if ((end > it->start) && ((it + 1 == this->regions.end()) || (end <= (it + 1)->start)))
+            {
+                it->end = end;
+                return;
+            }
+
+            break;
+        }
+    }
+
+    //No heap yet (or something unexpected), read it again:
+    invalidate();
+}
@@ -0,0 +1,88 @@
+#ifndef MEMORYMAP_H
+#define MEMORYMAP_H
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "Globals.hpp"
+
+using namespace std;
+
+//A mapped region of the debugged process (like a line of /proc/<pid>/maps):
+struct MemoryRegion
+{
+    //The address range (end is exclusive):
+    word start;
+    word end;
+
+    //The protection and sharing:
+    bool readable;
+    bool writable;
+    bool executable;
+    bool shared;
+
+    //The offset in the mapped file:
+    word offset;
+
+    //The mapped file resp. the pseudo name like "[heap]" (empty for anonymous memory):
+    string path;
+};
+
+class MemoryMap
+{
+    //Members:
+private:
+
+    //The PID of the debugged process (the map stays empty without one):
+    pid_t pid;
+
+    //The regions, sorted by address and not overlapping:
+    vector<MemoryRegion> regions;
+
+    //Do the regions reflect the process (otherwise they are parsed again on next use)?
+    bool valid;
+
+    //Methods:
+private:
+
+    //Parse /proc/<pid>/maps:
+    void parse();
+
+    //Parse again if necessary:
+    void ensureValid();
+
+    //Cut a range out of the regions (splitting the ones overlapping its ends):
+    void removeRange(word start, word end);
+
+    //Insert a region (replacing everything it overlaps):
+    void insertRegion(const MemoryRegion& region);
+
+public:
+
+    //Set the PID (this drops the regions):
+    void setPID(pid_t pid);
+
+    //Get the regions:
+    const vector<MemoryRegion>& getRegions();
+
+    //Constructor:
+    MemoryMap();
+
+    //Parse the regions again on next use (after changes we can't follow, like execve or mremap):
+    inline void invalidate() { this->valid = false; }
+
+    //Find the region containing an address in O(log n) (NULL if it is unmapped):
+    const MemoryRegion* findRegion(word address);
+
+    //Get the number of bytes mapped without a gap from an address on (at most count):
+    word getMappedLength(word address, word count);
+
+    //Follow the successful memory syscalls of the process:
+    void addMapping(word address, word length, int protection, int flags, int fd, word offset);
+    void removeMapping(word address, word length);
+    void protectMapping(word address, word length, int protection);
+    void setBreak(word address);
+};
+
+#endif // MEMORYMAP_H
@@ -0,0 +1,263 @@
+#include "MemorySnapshot.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Tracee.hpp"
+
+MemorySnapshot::MemorySnapshot()
+    : pid(-1), softDirty(false)
+{
+
+}
+
+
+void MemorySnapshot::clear()
+{
+    this->pid = -1;
+    this->regions.clear();
+    this->softDirty = false;
+}
+
+
+word MemorySnapshot::getPageCount() const
+{
+    word count = 0;
+
+    for (vector<MemorySnapshotRegion>::const_iterator it = this->regions.begin(); it != this->regions.end(); ++it)
+    {
+        count += it->data.size() / PAGE_SIZE_BYTES;
+    }
+
+    return count;
+}
+
+
+bool MemorySnapshot::isSoftDirtySupported()
+{
+    static int supported = -1;
+
+    if (supported >= 0)
+    {
+        return supported;
+    }
+
+    supported = 0;
+
+    //A new page is always soft-dirty once it's written:
+    void* page = mmap(NULL, PAGE_SIZE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (page == MAP_FAILED)
+    {
+        return supported;
+    }
+
+    *(volatile byte*)page = 1;
+
+    int file = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    uint64_t entry = 0;
+
+    if (file >= 0)
+    {
+        if (pread64(file, &entry, sizeof(entry), (off64_t)((word)page / PAGE_SIZE_BYTES) * sizeof(entry)) == sizeof(entry))
+        {
+            supported = (entry >> PAGEMAP_SOFT_DIRTY_BIT) & 1;
+        }
+
+        close(file);
+    }
+
+    munmap(page, PAGE_SIZE_BYTES);
+
+    return supported;
+}
+
+
+bool MemorySnapshot::clearSoftDirty()
+{
+    int file = open(("/proc/" + to_string(this->pid) + "/clear_refs").c_str(), O_WRONLY | O_CLOEXEC);
+
+    if (file < 0)
+    {
+        return false;
+    }
+
+    //"4" clears the soft-dirty bits (this fails without CONFIG_MEM_SOFT_DIRTY):
+    bool result = (write(file, "4", 1) == 1);
+    close(file);
+
+    return result;
+}
+
+
+vector<bool> MemorySnapshot::getDirtyPages(int pagemapFile, const MemorySnapshotRegion& region) const
+{
+    word pageCount = region.data.size() / PAGE_SIZE_BYTES;
+    vector<bool> dirty(pageCount, true);
+
+    if (!this->softDirty || (pagemapFile < 0))
+    {
+        return dirty;
+    }
+
+    //One 64 bit entry per page:
+    vector<uint64_t> entries(pageCount);
+    off64_t offset = (off64_t)(region.start / PAGE_SIZE_BYTES) * sizeof(uint64_t);
+
+    if (pread64(pagemapFile, &entries[0], pageCount * sizeof(uint64_t), offset) != (ssize_t)(pageCount * sizeof(uint64_t)))
+    {
+        return dirty;
+    }
+
+    for (word i = 0; i < pageCount; i++)
+    {
+        dirty[i] = (entries[i] >> PAGEMAP_SOFT_DIRTY_BIT) & 1;
+    }
+
+    return dirty;
+}
+
+
+void MemorySnapshot::compare(word address, const byte* before, const byte* after, word size, const string& path, vector<MemoryChange>& changes)
+{
+    word i = 0;
+
+    while (i < size)
+    {
+        //Skip equal words quickly:
+        if (((i % WORD_SIZE_BYTES) == 0) && ((i + WORD_SIZE_BYTES) <= size) && !memcmp(before + i, after + i, WORD_SIZE_BYTES))
+        {
+            i += WORD_SIZE_BYTES;
+            continue;
+        }
+
+        if (before[i] == after[i])
+        {
+            i++;
+            continue;
+        }
+
+        //Extend the change until there is a longer gap:
+        word start = i;
+        word end = i + 1;
+
+        for (i++; (i < size) && (i < (end + MEMORY_SNAPSHOT_GAP_BYTES)); i++)
+        {
+            if (before[i] != after[i])
+            {
+                end = i + 1;
+            }
+        }
+
+        i = end;
+
+        MemoryChange change;
+        change.address = address + start;
+        change.before.assign(before + start, before + end);
+        change.after.assign(after + start, after + end);
+        change.path = path;
+
+        changes.push_back(change);
+    }
+}
+
+
+void MemorySnapshot::take(Tracee& tracee, const vector<MemoryRegion>& regions)
+{
+    clear();
+    this->pid = tracee.getPID();
+
+    for (vector<MemoryRegion>::const_iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        MemorySnapshotRegion region;
+        region.start = it->start;
+        region.end = it->end;
+        region.path = it->path;
+        region.data.resize(it->end - it->start);
+
+        //Keep the readable prefix (whole pages only):
+        word readCount = 0;
+
+        while (readCount < region.data.size())
+        {
+            word count = min((word)region.data.size() - readCount, (word)MEMORY_SNAPSHOT_CHUNK_BYTES);
+            word chunkCount = tracee.readMemoryDirect((pword)(it->start + readCount), count, &region.data[readCount]);
+
+            readCount += chunkCount;
+
+            if (chunkCount < count)
+            {
+                break;
+            }
+        }
+
+        region.data.resize(readCount & ~((word)PAGE_SIZE_BYTES - 1));
+
+        if (!region.data.empty())
+        {
+            this->regions.push_back(region);
+        }
+    }
+
+    //Track the writes from now on:
+    this->softDirty = isSoftDirtySupported() && clearSoftDirty();
+}
+
+
+word MemorySnapshot::diff(Tracee& tracee, vector<MemoryChange>& changes)
+{
+    int pagemapFile = open(("/proc/" + to_string(this->pid) + "/pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+    vector<byte> current;
+    word comparedCount = 0;
+
+    for (vector<MemorySnapshotRegion>::iterator it = this->regions.begin(); it != this->regions.end(); ++it)
+    {
+        vector<bool> dirty = getDirtyPages(pagemapFile, *it);
+        word pageCount = dirty.size();
+
+        //Read runs of dirty pages at once (up to a chunk, a longer run goes on with the next one):
+        for (word page = 0; page < pageCount; page++)
+        {
+            if (!dirty[page])
+            {
+                continue;
+            }
+
+            word runEnd = page + 1;
+
+            while ((runEnd < pageCount) && dirty[runEnd] && ((runEnd - page) < (MEMORY_SNAPSHOT_CHUNK_BYTES / PAGE_SIZE_BYTES)))
+            {
+                runEnd++;
+            }
+
+            word offset = page * PAGE_SIZE_BYTES;
+            word size = (runEnd - page) * PAGE_SIZE_BYTES;
+
+            current.resize(size);
+            size = tracee.readMemoryDirect((pword)(it->start + offset), size, &current[0]);
+
+            //Compare and take over the new content:
+            compare(it->start + offset, &it->data[offset], &current[0], size, it->path, changes);
+            memcpy(&it->data[offset], &current[0], size);
+
+            comparedCount += runEnd - page;
+            page = runEnd - 1;
+        }
+    }
+
+    if (pagemapFile >= 0)
+    {
+        close(pagemapFile);
+    }
+
+    //The next diff starts here:
+    if (this->softDirty)
+    {
+        this->softDirty = clearSoftDirty();
+    }
+
+    return comparedCount;
+}
@@ -0,0 +1,102 @@
+#ifndef MEMORYSNAPSHOT_H
+#define MEMORYSNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include "Globals.hpp"
+#include "MemoryMap.hpp"
+
+//The soft-dirty bit of a /proc/<pid>/pagemap entry:
+#define PAGEMAP_SOFT_DIRTY_BIT 55
+
+//Changed bytes closer than that are reported as one change:
+#define MEMORY_SNAPSHOT_GAP_BYTES 8
+
+//Memory is read in chunks of that size (a read count must fit into an int):
+#define MEMORY_SNAPSHOT_CHUNK_BYTES (4 * 1024 * 1024)
+
+using namespace std;
+
+class Tracee;
+
+//A saved region:
+struct MemorySnapshotRegion
+{
+    //The address range and the mapped file:
+    word start;
+    word end;
+    string path;
+
+    //The content (only the readable prefix of the region):
+    vector<byte> data;
+};
+
+//A changed range of memory:
+struct MemoryChange
+{
+    //The address:
+    word address;
+
+    //The content before and after:
+    vector<byte> before;
+    vector<byte> after;
+
+    //The path of the region:
+    string path;
+};
+
+//Saves the writable memory and finds the changes later.
+//The kernel's soft-dirty bits tell which pages were written since the snapshot, so only these are compared:
+class MemorySnapshot
+{
+    //Members:
+private:
+
+    //The PID of the process the snapshot belongs to:
+    pid_t pid;
+
+    //The saved regions:
+    vector<MemorySnapshotRegion> regions;
+
+    //Are the soft-dirty bits usable (otherwise every page is compared)?
+    bool softDirty;
+
+    //Methods:
+private:
+
+    //Does the kernel track soft-dirty pages?
+    //Kernels without CONFIG_MEM_SOFT_DIRTY accept clearing them as well, so this checks a freshly written page of our own:
+    static bool isSoftDirtySupported();
+
+    //Clear the soft-dirty bits of all pages of the process (false if that failed):
+    bool clearSoftDirty();
+
+    //Find the dirty pages of a region (all of them without soft-dirty support):
+    vector<bool> getDirtyPages(int pagemapFile, const MemorySnapshotRegion& region) const;
+
+    //Compare saved and current content and add the changed ranges:
+    static void compare(word address, const byte* before, const byte* after, word size, const string& path, vector<MemoryChange>& changes);
+
+public:
+
+    //Getters:
+    inline bool isTaken() const { return this->pid > 0; }
+    inline bool usesSoftDirty() const { return this->softDirty; }
+    word getPageCount() const;
+
+    //Constructor:
+    MemorySnapshot();
+
+    //Drop the snapshot:
+    void clear();
+
+    //Save some regions and start tracking their writes (the process must be stopped):
+    void take(Tracee& tracee, const vector<MemoryRegion>& regions);
+
+    //Find the changes since the snapshot resp. the last diff and roll the snapshot forward.
+    //This returns the number of pages compared:
+    word diff(Tracee& tracee, vector<MemoryChange>& changes);
+};
+
+#endif // MEMORYSNAPSHOT_H
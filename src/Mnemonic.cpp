@@ -1,57 +1,165 @@
 #include "Mnemonic.hpp"
 
-#define PACKAGE 1
-#define PACKAGE_VERSION 1
-#include <bfd.h>
-
-#include <dis-asm.h>
-#include <stdexcept>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
-Mnemonic::Mnemonic(pword buffer, bool att)
-    : opcodeLength(0), assemblyString("")
+Mnemonic::Mnemonic(const byte* opcode, int opcodeLength, const char* assembly, int assemblyLength)
+    : opcodeLength(opcodeLength)
 {
-    //NULL the opcode:
+    //NULL the opcode and copy the used part:
     memset(this->opcode, 0, MAX_INSTRUCTION_BYTES);
+    memcpy(this->opcode, opcode, this->opcodeLength);
 
-    //Open a memory stream:
-    char stringBuffer[256];
-    FILE* memStream = fmemopen(stringBuffer, 256, "w");
-
-    if (!memStream)
+    //Copy the assembly text (truncated if necessary):
+    if (assemblyLength > (MAX_ASSEMBLY_LENGTH - 1))
     {
-        throw runtime_error("Failed to open memory stream.");
+        assemblyLength = MAX_ASSEMBLY_LENGTH - 1;
     }
 
-    //Prepare disassembly info (bfd):
-    struct disassemble_info info;
-    init_disassemble_info(&info, memStream, (fprintf_ftype)fprintf);
+    this->assembly.assign(assembly, assemblyLength);
+}
+
 
-    //This is the same for all architectures:
-    info.buffer = (bfd_byte*)buffer;
-    info.buffer_length = MAX_INSTRUCTION_BYTES;
+int Mnemonic::getPrefixLength() const
+{
+    int i = 0;
 
-    //Discriminate between architectures:
-#ifdef __i386__
-    info.arch = bfd_arch_i386;
-    info.mach = att ? bfd_mach_i386_i386 : bfd_mach_i386_i386_intel_syntax;
-    info.endian = BFD_ENDIAN_LITTLE;
-    this->opcodeLength = att ? print_insn_i386(0, &info) : print_insn_i386_intel(0, &info);
-#elif __amd64__
-    info.arch = bfd_arch_i386;
-    info.mach = att ? bfd_mach_x86_64 : bfd_mach_x86_64_intel_syntax;
-    info.endian = BFD_ENDIAN_LITTLE;
-    this->opcodeLength = att ? print_insn_i386(0, &info) : print_insn_i386_intel(0, &info);
+    while (i < this->opcodeLength)
+    {
+        byte current = this->opcode[i];
+
+        if ((current == 0x66) || (current == 0x67) || (current == 0xf0) || (current == 0xf2) || (current == 0xf3) ||
+            (current == 0x26) || (current == 0x2e) || (current == 0x36) || (current == 0x3e) || (current == 0x64) || (current == 0x65))
+        {
+            i++;
+        }
+#ifdef __amd64__
+        else if ((current & 0xf0) == 0x40)
+        {
+            i++;
+        }
 #endif
+        else
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+bool Mnemonic::isSyscall() const
+{
+    int i = getPrefixLength();
+
+    if ((this->opcodeLength - i) < 2)
+    {
+        return false;
+    }
+
+    //int imm8, syscall, sysenter:
+    return (this->opcode[i] == 0xcd) || ((this->opcode[i] == 0x0f) && ((this->opcode[i + 1] == 0x05) || (this->opcode[i + 1] == 0x34)));
+}
+
+
+BranchType Mnemonic::getBranchType(word address, word& target) const
+{
+    int i = getPrefixLength();
+    target = 0;
+
+    //The relative targets are based on the next instruction:
+    word next = address + this->opcodeLength;
+    int rest = this->opcodeLength - i;
+
+    if (rest < 1)
+    {
+        return BRANCH_TYPE_NONE;
+    }
+
+    byte code = this->opcode[i];
+    int32_t displacement;
+
+    //jcc rel8, loop/loope/loopne/jcxz rel8:
+    if (((code >= 0x70) && (code <= 0x7f)) || ((code >= 0xe0) && (code <= 0xe3)))
+    {
+        if (rest < 2)
+        {
+            return BRANCH_TYPE_NONE;
+        }
+
+        target = next + (int8_t)this->opcode[i + 1];
+        return BRANCH_TYPE_CONDITIONAL;
+    }
+
+    //jmp rel8:
+    if (code == 0xeb)
+    {
+        if (rest < 2)
+        {
+            return BRANCH_TYPE_NONE;
+        }
+
+        target = next + (int8_t)this->opcode[i + 1];
+        return BRANCH_TYPE_DIRECT;
+    }
+
+    //call rel32, jmp rel32:
+    if ((code == 0xe8) || (code == 0xe9))
+    {
+        if (rest < 5)
+        {
+            return BRANCH_TYPE_NONE;
+        }
+
+        memcpy(&displacement, this->opcode + i + 1, sizeof(displacement));
+        target = next + (long)displacement;
+
+        return BRANCH_TYPE_DIRECT;
+    }
+
+    //ret, ret imm16, retf, retf imm16, iret, far jmp/call:
+    if ((code == 0xc3) || (code == 0xc2) || (code == 0xcb) || (code == 0xca) || (code == 0xcf) || (code == 0xea) || (code == 0x9a))
+    {
+        return BRANCH_TYPE_INDIRECT;
+    }
 
-    //Close the stream:
-    fclose(memStream);
+    //int3, into, int1 and the syscalls:
+    if ((code == 0xcc) || (code == 0xce) || (code == 0xf1) || isSyscall())
+    {
+        return BRANCH_TYPE_SYSTEM;
+    }
 
-    //Assign:
-    this->assemblyString = stringBuffer;
+    //call/jmp (near and far) via register or memory (group 5, /2 to /5):
+    if (code == 0xff)
+    {
+        if (rest < 2)
+        {
+            return BRANCH_TYPE_NONE;
+        }
+
+        int operation = (this->opcode[i + 1] >> 3) & 7;
+        return ((operation >= 2) && (operation <= 5)) ? BRANCH_TYPE_INDIRECT : BRANCH_TYPE_NONE;
+    }
+
+    //Two byte opcodes:
+    if ((code == 0x0f) && (rest >= 2))
+    {
+        byte second = this->opcode[i + 1];
+
+        //jcc rel32:
+        if ((second >= 0x80) && (second <= 0x8f))
+        {
+            if (rest < 6)
+            {
+                return BRANCH_TYPE_NONE;
+            }
+
+            memcpy(&displacement, this->opcode + i + 2, sizeof(displacement));
+            target = next + (long)displacement;
+
+            return BRANCH_TYPE_CONDITIONAL;
+        }
+    }
 
-    //Build the raw opcode buffer from the length:
-    memcpy(this->opcode, buffer, this->opcodeLength);
+    return BRANCH_TYPE_NONE;
 }
@@ -5,8 +5,30 @@
 
 #include <string>
 
+//The max length of the assembly text of one instruction while it is formatted (including the terminating 0):
+#define MAX_ASSEMBLY_LENGTH 256
+
 using namespace std;
 
+//The kinds of control transfers:
+enum BranchType
+{
+    //No branch:
+    BRANCH_TYPE_NONE,
+
+    //Conditional with a relative target (jcc, loop, jcxz):
+    BRANCH_TYPE_CONDITIONAL,
+
+    //Unconditional with a relative target (jmp, call):
+    BRANCH_TYPE_DIRECT,
+
+    //The target is in a register or memory (indirect jmp/call, ret, far transfers):
+    BRANCH_TYPE_INDIRECT,
+
+    //Into the kernel and back to the next instruction (syscall, sysenter, int):
+    BRANCH_TYPE_SYSTEM
+};
+
 class Mnemonic
 {
     //Members:
@@ -18,19 +40,33 @@ private:
     //The opcode itself:
     byte opcode[MAX_INSTRUCTION_BYTES];
 
-    //The string containing the corresponding assembly code:
-    string assemblyString;
+    //The corresponding assembly code (empty if only the length has been decoded).
+    //It is stored out of line, so copies of decoded instructions and the decode cache stay small:
+    string assembly;
 
     //Methods:
+private:
+
+    //Get the number of prefix bytes (operand/address size, lock/rep, segments and REX):
+    int getPrefixLength() const;
+
 public:
 
     //Access the members:
     inline int getOpcodeLength() const { return this->opcodeLength; }
     inline byte* getOpcode() { return this->opcode; }
-    inline string getAssemblyString() const { return this->assemblyString; }
+    inline const char* getAssembly() const { return this->assembly.c_str(); }
+    inline const string& getAssemblyString() const { return this->assembly; }
+
+    //Does it enter the kernel by a syscall (syscall, sysenter, int imm8)?
+    bool isSyscall() const;
+
+    //Classify the instruction as a branch by its opcode.
+    //The target is set for conditional and direct branches only:
+    BranchType getBranchType(word address, word& target) const;
 
-    //Constructor:
-    Mnemonic(pword buffer, bool att);
+    //Constructor (the opcode buffer must hold at least opcodeLength bytes):
+    Mnemonic(const byte* opcode, int opcodeLength, const char* assembly, int assemblyLength);
 };
 
 #endif // MNEMONIC_H
@@ -0,0 +1,332 @@
+#include "ParallelDisassembler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <signal.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Disassembler.hpp"
+#include "SymbolTable.hpp"
+
+//The memory shared between the parent and the workers.
+//The workers pull chunks from a common counter, so fast workers take over the work of slow ones:
+struct ParallelDisassemblyShared
+{
+    atomic<int> nextChunk;
+    ParallelDisassemblyResult results[1];
+};
+
+ParallelDisassembler::ParallelDisassembler(const byte* code, word address, word size, bool att, const SymbolTable* symbols, word symbolBias)
+    : code(code), address(address), size(size), att(att), symbols(symbols), symbolBias(symbolBias)
+{
+    //One chunk for everything until split:
+    ParallelDisassemblyChunk chunk;
+    chunk.start = address;
+    chunk.end = address + size;
+
+    this->chunks.push_back(chunk);
+}
+
+
+void ParallelDisassembler::split(vector<word> boundaries)
+{
+    //Sort the boundaries and drop the ones outside the region:
+    sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    this->chunks.clear();
+
+    ParallelDisassemblyChunk chunk;
+    chunk.start = this->address;
+
+    for (vector<word>::iterator it = boundaries.begin(); it != boundaries.end(); ++it)
+    {
+        if ((*it <= this->address) || (*it >= (this->address + this->size)))
+        {
+            continue;
+        }
+
+        //Close the chunk if it is large enough:
+        if ((*it - chunk.start) >= PARALLEL_DISASSEMBLY_MIN_CHUNK_BYTES)
+        {
+            chunk.end = *it;
+            this->chunks.push_back(chunk);
+
+            chunk.start = *it;
+        }
+    }
+
+    //The last one:
+    chunk.end = this->address + this->size;
+    this->chunks.push_back(chunk);
+}
+
+
+void ParallelDisassembler::decodeChunk(const ParallelDisassemblyChunk& chunk, Disassembler& disassembler, vector<char>& text)
+{
+    char line[MAX_ASSEMBLY_LENGTH + 64];
+    word current = chunk.start;
+
+    while (current < chunk.end)
+    {
+        //Decode out of the region buffer (it is padded, so the last instruction can't overrun it):
+        Mnemonic mnemonic = disassembler.decode(this->code + (current - this->address), MAX_INSTRUCTION_BYTES, this->att);
+
+        //Label the start of every symbol (and the start of the region), independent of the chunk layout:
+        const char* name = NULL;
+        word offset = 0;
+        int length = 0;
+
+        if (this->symbols && this->symbols->lookup(current - this->symbolBias, name, offset) && ((offset == 0) || (current == this->address)))
+        {
+            length = (offset == 0) ? snprintf(line, sizeof(line), "<%s>:\n", name) : snprintf(line, sizeof(line), "<%s+0x%lx>:\n", name, (unsigned long)offset);
+            text.insert(text.end(), line, line + min(length, (int)sizeof(line) - 1));
+        }
+
+        //Format like the disassemble command:
+        length = snprintf(line, sizeof(line), "\t<0x%0*lx>\t%s\n", 2 * WORD_SIZE_BYTES, (unsigned long)current, mnemonic.getAssembly());
+        text.insert(text.end(), line, line + min(length, (int)sizeof(line) - 1));
+
+        current += mnemonic.getOpcodeLength();
+    }
+}
+
+
+void ParallelDisassembler::work(int worker, int outputFile, int notifyFile, void* shared)
+{
+    ParallelDisassemblyShared* state = (ParallelDisassemblyShared*)shared;
+
+    //Every worker process has its own libopcodes state:
+    Disassembler disassembler;
+    vector<char> text;
+    off_t offset = 0;
+
+    while (true)
+    {
+        //Take the next chunk:
+        int index = state->nextChunk.fetch_add(1);
+
+        if (index >= (int)this->chunks.size())
+        {
+            break;
+        }
+
+        //Decode it:
+        text.clear();
+        decodeChunk(this->chunks[index], disassembler, text);
+
+        //Append it to our own output file:
+        size_t written = 0;
+
+        while (written < text.size())
+        {
+            ssize_t result = write(outputFile, &text[written], text.size() - written);
+
+            if (result <= 0)
+            {
+                return;
+            }
+
+            written += result;
+        }
+
+        //Publish where it is and tell the parent (it writes the chunks in order as soon as they are done):
+        state->results[index].offset = offset;
+        state->results[index].length = text.size();
+        state->results[index].worker = worker;
+
+        if (write(notifyFile, &index, sizeof(index)) != sizeof(index))
+        {
+            return;
+        }
+
+        offset += text.size();
+    }
+}
+
+
+bool ParallelDisassembler::writeChunk(unsigned int index, void* shared, const vector<FILE*>& workerFiles, Disassembler& disassembler, int outputFile)
+{
+    ParallelDisassemblyResult& result = ((ParallelDisassemblyShared*)shared)->results[index];
+    vector<char> text;
+
+    //Chunks without a result (no worker could be started or a worker died) are decoded here:
+    if (result.worker >= 0)
+    {
+        text.resize(result.length);
+
+        if (pread(fileno(workerFiles[result.worker]), text.empty() ? NULL : &text[0], result.length, result.offset) != (ssize_t)result.length)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        decodeChunk(this->chunks[index], disassembler, text);
+    }
+
+    //Stream it out:
+    size_t written = 0;
+
+    while (written < text.size())
+    {
+        ssize_t count = write(outputFile, &text[written], text.size() - written);
+
+        if (count <= 0)
+        {
+            return false;
+        }
+
+        written += count;
+    }
+
+    return true;
+}
+
+
+void ParallelDisassembler::run(int outputFile)
+{
+    //One worker per core, but not more than there are chunks:
+    int workerCount = min((int)sysconf(_SC_NPROCESSORS_ONLN), (int)this->chunks.size());
+
+    if (workerCount < 1)
+    {
+        workerCount = 1;
+    }
+
+    //Map the shared state:
+    size_t sharedSize = sizeof(ParallelDisassemblyShared) + (this->chunks.size() * sizeof(ParallelDisassemblyResult));
+    void* shared = mmap(NULL, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (shared == MAP_FAILED)
+    {
+        throw runtime_error(string("Failed to map the shared worker state (mmap error code: ") + strerror(errno) + ").");
+    }
+
+    ParallelDisassemblyShared* state = new (shared) ParallelDisassemblyShared;
+    state->nextChunk = 0;
+
+    for (unsigned int i = 0; i < this->chunks.size(); i++)
+    {
+        state->results[i].worker = -1;
+    }
+
+    //The workers report every finished chunk through a pipe:
+    int notifications[2];
+
+    if (pipe2(notifications, O_CLOEXEC))
+    {
+        munmap(shared, sharedSize);
+        throw runtime_error(string("Failed to create the worker pipe (pipe error code: ") + strerror(errno) + ").");
+    }
+
+    //Every worker gets an anonymous temporary file for its text:
+    vector<FILE*> workerFiles;
+    vector<pid_t> workers;
+
+    //Nothing buffered may be duplicated into the workers:
+    cout.flush();
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        FILE* file = tmpfile();
+
+        if (!file)
+        {
+            break;
+        }
+
+        workerFiles.push_back(file);
+
+        pid_t pid = fork();
+
+        //Child (it never returns into the debugger).
+        //It only uses its own disassembler, the shared state and malloc (which glibc keeps usable across fork):
+        if (pid == 0)
+        {
+            close(notifications[0]);
+            work(i, fileno(file), notifications[1], shared);
+            _exit(0);
+        }
+
+        //Error: The other workers (or we ourselves, below) take over:
+        if (pid == -1)
+        {
+            break;
+        }
+
+        workers.push_back(pid);
+    }
+
+    //Only the workers write into the pipe, so it ends when the last one has left:
+    close(notifications[1]);
+
+    //Write the chunks in address order, each one as soon as it and all before it are done:
+    Disassembler disassembler;
+    vector<bool> done(this->chunks.size(), false);
+    unsigned int nextChunk = 0;
+    bool failed = false;
+
+    while ((nextChunk < this->chunks.size()) && !failed)
+    {
+        int index;
+        ssize_t count = read(notifications[0], &index, sizeof(index));
+
+        if ((count < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+
+        if ((count != sizeof(index)) || (index < 0) || (index >= (int)this->chunks.size()))
+        {
+            break;
+        }
+
+        done[index] = true;
+
+        while ((nextChunk < this->chunks.size()) && done[nextChunk] && !failed)
+        {
+            failed = !writeChunk(nextChunk++, shared, workerFiles, disassembler, outputFile);
+        }
+    }
+
+    close(notifications[0]);
+
+    //Stop the workers if the output has failed, wait for them otherwise:
+    for (vector<pid_t>::iterator it = workers.begin(); it != workers.end(); ++it)
+    {
+        if (failed)
+        {
+            kill(*it, SIGKILL);
+        }
+
+        waitpid(*it, NULL, 0);
+    }
+
+    //The rest (chunks of workers that died or could not be started):
+    while ((nextChunk < this->chunks.size()) && !failed)
+    {
+        failed = !writeChunk(nextChunk++, shared, workerFiles, disassembler, outputFile);
+    }
+
+    //Clean up:
+    for (vector<FILE*>::iterator it = workerFiles.begin(); it != workerFiles.end(); ++it)
+    {
+        fclose(*it);
+    }
+
+    munmap(shared, sharedSize);
+
+    if (failed)
+    {
+        throw runtime_error("Failed to write the disassembly.");
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef PARALLELDISASSEMBLER_H
+#define PARALLELDISASSEMBLER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "Globals.hpp"
+
+//Chunks are merged at symbol boundaries until they have at least this size:
+#define PARALLEL_DISASSEMBLY_MIN_CHUNK_BYTES (64 * 1024)
+
+using namespace std;
+
+class Disassembler;
+class SymbolTable;
+
+//A part of the region decoded by one worker at once:
+struct ParallelDisassemblyChunk
+{
+    //The address range of the chunk (it starts at an instruction boundary):
+    word start;
+    word end;
+};
+
+//The result of a chunk, written by a worker into shared memory:
+struct ParallelDisassemblyResult
+{
+    //The worker that decoded the chunk (-1 if it has not been decoded):
+    int worker;
+
+    //The location of the text within the worker's output file:
+    off_t offset;
+    size_t length;
+};
+
+class ParallelDisassembler
+{
+    //Members:
+private:
+
+    //The code and its address (the buffer must hold MAX_INSTRUCTION_BYTES of padding after size):
+    const byte* code;
+    word address;
+    word size;
+
+    //Use the AT&T flavor?
+    bool att;
+
+    //The symbols used to label the text (may be NULL):
+    const SymbolTable* symbols;
+
+    //The load bias of the symbols (runtime address = symbol address + bias):
+    word symbolBias;
+
+    //The chunks in address order:
+    vector<ParallelDisassemblyChunk> chunks;
+
+    //Methods:
+private:
+
+    //Decode one chunk and append the text to a buffer:
+    void decodeChunk(const ParallelDisassemblyChunk& chunk, Disassembler& disassembler, vector<char>& text);
+
+    //The loop of a worker process (it reports the index of every finished chunk to the notify file):
+    void work(int worker, int outputFile, int notifyFile, void* shared);
+
+    //Write the text of a chunk, out of the file of its worker or decoded here if there is none (false on errors):
+    bool writeChunk(unsigned int index, void* shared, const vector<FILE*>& workerFiles, Disassembler& disassembler, int outputFile);
+
+public:
+
+    //Constructor:
+    ParallelDisassembler(const byte* code, word address, word size, bool att, const SymbolTable* symbols = NULL, word symbolBias = 0);
+
+    //Split the region into chunks at the given instruction boundaries (e.g. symbol addresses):
+    void split(vector<word> boundaries);
+
+    //Decode all chunks on a pool of worker processes and write the text in address order to a file descriptor.
+    //Every chunk is written as soon as it and all chunks before it are done.
+    //The workers are forked from the calling thread only, so the other threads of the process must be idle meanwhile
+    //(a lock held by one of them would stay locked in the workers forever, see DebugLoop::quiesceThreads()):
+    void run(int outputFile);
+};
+
+#endif // PARALLELDISASSEMBLER_H
@@ -0,0 +1,232 @@
+#include "PatternScanner.hpp"
+
+#include <ctype.h>
+#include <immintrin.h>
+#include <stdexcept>
+#include <string.h>
+
+//The search kernel (selected once by the CPU features):
+typedef void (*PatternKernel)(const byte* data, word size, const byte* pattern, const byte* mask, word length, word firstFixed, word lastFixed, vector<word>& offsets);
+
+//Compare a candidate with the pattern, ignoring the wildcards:
+static inline bool matchesAt(const byte* data, const byte* pattern, const byte* mask, word length)
+{
+    for (word i = 0; i < length; i++)
+    {
+        if ((data[i] ^ pattern[i]) & mask[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//Scalar fallback (memchr finds the first fixed byte):
+static void findScalar(const byte* data, word size, const byte* pattern, const byte* mask, word length, word firstFixed, word lastFixed, vector<word>& offsets)
+{
+    UNUSED(lastFixed);
+
+    if (size < length)
+    {
+        return;
+    }
+
+    //The first fixed byte of the last candidate:
+    const byte* searchEnd = data + (size - length) + firstFixed + 1;
+    const byte* current = data + firstFixed;
+
+    while (current < searchEnd)
+    {
+        current = (const byte*)memchr(current, pattern[firstFixed], searchEnd - current);
+
+        if (!current)
+        {
+            break;
+        }
+
+        const byte* candidate = current - firstFixed;
+
+        if (matchesAt(candidate, pattern, mask, length))
+        {
+            offsets.push_back(candidate - data);
+        }
+
+        current++;
+    }
+}
+
+
+//Verify the candidates of a filter bit mask:
+static inline void verifyCandidates(uint32_t bits, word position, const byte* data, const byte* pattern, const byte* mask, word length, vector<word>& offsets)
+{
+    while (bits)
+    {
+        word candidate = position + __builtin_ctz(bits);
+
+        if (matchesAt(data + candidate, pattern, mask, length))
+        {
+            offsets.push_back(candidate);
+        }
+
+        bits &= bits - 1;
+    }
+}
+
+
+//SSE2 (16 candidates per step):
+__attribute__((target("sse2")))
+static void findSse2(const byte* data, word size, const byte* pattern, const byte* mask, word length, word firstFixed, word lastFixed, vector<word>& offsets)
+{
+    word candidateCount = size - length + 1;
+    __m128i first = _mm_set1_epi8((char)pattern[firstFixed]);
+    __m128i last = _mm_set1_epi8((char)pattern[lastFixed]);
+    word position = 0;
+
+    for (; (position + 16) <= candidateCount; position += 16)
+    {
+        __m128i firstBytes = _mm_loadu_si128((const __m128i*)(data + position + firstFixed));
+        __m128i lastBytes = _mm_loadu_si128((const __m128i*)(data + position + lastFixed));
+        uint32_t bits = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBytes, first), _mm_cmpeq_epi8(lastBytes, last)));
+
+        verifyCandidates(bits, position, data, pattern, mask, length, offsets);
+    }
+
+    //The rest:
+    size_t count = offsets.size();
+    findScalar(data + position, size - position, pattern, mask, length, firstFixed, lastFixed, offsets);
+
+    for (; count < offsets.size(); count++)
+    {
+        offsets[count] += position;
+    }
+}
+
+
+//AVX2 (32 candidates per step):
+__attribute__((target("avx2")))
+static void findAvx2(const byte* data, word size, const byte* pattern, const byte* mask, word length, word firstFixed, word lastFixed, vector<word>& offsets)
+{
+    word candidateCount = size - length + 1;
+    __m256i first = _mm256_set1_epi8((char)pattern[firstFixed]);
+    __m256i last = _mm256_set1_epi8((char)pattern[lastFixed]);
+    word position = 0;
+
+    for (; (position + 32) <= candidateCount; position += 32)
+    {
+        __m256i firstBytes = _mm256_loadu_si256((const __m256i*)(data + position + firstFixed));
+        __m256i lastBytes = _mm256_loadu_si256((const __m256i*)(data + position + lastFixed));
+        uint32_t bits = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(firstBytes, first), _mm256_cmpeq_epi8(lastBytes, last)));
+
+        verifyCandidates(bits, position, data, pattern, mask, length, offsets);
+    }
+
+    //The rest:
+    size_t count = offsets.size();
+    findScalar(data + position, size - position, pattern, mask, length, firstFixed, lastFixed, offsets);
+
+    for (; count < offsets.size(); count++)
+    {
+        offsets[count] += position;
+    }
+}
+
+
+//Select the best kernel for this CPU:
+static PatternKernel selectKernel()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return findAvx2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return findSse2;
+    }
+
+    return findScalar;
+}
+
+
+PatternScanner::PatternScanner(const vector<byte>& pattern, const vector<byte>& mask)
+    : pattern(pattern), mask(mask), firstFixed(0), lastFixed(0)
+{
+    //Find the fixed bytes at both ends:
+    bool found = false;
+
+    for (word i = 0; i < this->mask.size(); i++)
+    {
+        if (this->mask[i])
+        {
+            if (!found)
+            {
+                this->firstFixed = i;
+                found = true;
+            }
+
+            this->lastFixed = i;
+        }
+    }
+
+    if (!found)
+    {
+        throw runtime_error("The pattern needs at least one byte that is not a wildcard.");
+    }
+}
+
+
+PatternScanner PatternScanner::fromHex(const string& text)
+{
+    if ((text.size() == 0) || ((text.size() % 2) != 0))
+    {
+        throw runtime_error("The hex pattern must consist of byte pairs (\"??\" for any byte).");
+    }
+
+    vector<byte> pattern;
+    vector<byte> mask;
+
+    for (size_t i = 0; i < text.size(); i += 2)
+    {
+        string pair = text.substr(i, 2);
+
+        if (pair == "??")
+        {
+            pattern.push_back(0);
+            mask.push_back(0x00);
+        }
+        else if (isxdigit(pair[0]) && isxdigit(pair[1]))
+        {
+            pattern.push_back((byte)stoul(pair, NULL, 16));
+            mask.push_back(0xff);
+        }
+        else
+        {
+            throw runtime_error("Invalid byte in the hex pattern: \"" + pair + "\".");
+        }
+    }
+
+    return PatternScanner(pattern, mask);
+}
+
+
+PatternScanner PatternScanner::fromString(const string& text)
+{
+    return PatternScanner(vector<byte>(text.begin(), text.end()), vector<byte>(text.size(), 0xff));
+}
+
+
+void PatternScanner::find(const byte* data, word size, vector<word>& offsets) const
+{
+    static const PatternKernel kernel = selectKernel();
+
+    if (size < this->pattern.size())
+    {
+        return;
+    }
+
+    kernel(data, size, &this->pattern[0], &this->mask[0], this->pattern.size(), this->firstFixed, this->lastFixed, offsets);
+}
@@ -0,0 +1,44 @@
+#ifndef PATTERNSCANNER_H
+#define PATTERNSCANNER_H
+
+#include <string>
+#include <vector>
+
+#include "Globals.hpp"
+
+using namespace std;
+
+//Finds a byte pattern with wildcards in memory.
+//Two fixed bytes of the pattern are compared 32 resp. 16 positions at once (AVX2 resp. SSE2) and only the candidates are verified:
+class PatternScanner
+{
+    //Members:
+private:
+
+    //The pattern and its mask (0xff for fixed bytes, 0x00 for wildcards):
+    vector<byte> pattern;
+    vector<byte> mask;
+
+    //The positions of the first and the last fixed byte (the filter compares these two):
+    word firstFixed;
+    word lastFixed;
+
+public:
+
+    //Getters:
+    inline word getLength() const { return this->pattern.size(); }
+
+    //Constructor (throws an exception if there is no fixed byte):
+    PatternScanner(const vector<byte>& pattern, const vector<byte>& mask);
+
+    //Parse a pattern like "4e45??4c45" ("??" is a wildcard) resp. take a string literally.
+    //This throws an exception if the hex pattern is malformed:
+    static PatternScanner fromHex(const string& text);
+    static PatternScanner fromString(const string& text);
+
+    //Find all matches starting in a buffer (only matches completely inside of it count).
+    //The offsets of the matches are appended:
+    void find(const byte* data, word size, vector<word>& offsets) const;
+};
+
+#endif // PATTERNSCANNER_H
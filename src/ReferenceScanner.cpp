@@ -0,0 +1,127 @@
+#include "ReferenceScanner.hpp"
+
+#include <immintrin.h>
+
+//The search kernel (selected once by the CPU features):
+typedef void (*ReferenceKernel)(const word* data, word count, word start, word size, vector<word>& indices);
+
+//Scalar fallback (unsigned wrap-around turns the range check into one compare):
+static void findScalar(const word* data, word count, word start, word size, vector<word>& indices)
+{
+    for (word i = 0; i < count; i++)
+    {
+        if ((data[i] - start) < size)
+        {
+            indices.push_back(i);
+        }
+    }
+}
+
+
+#ifdef __amd64__
+
+//There is no unsigned compare, flipping the sign bit makes the signed one work:
+#define REFERENCE_SIGN_BIT ((long long)0x8000000000000000ULL)
+
+//SSE4.2 (2 words per step):
+__attribute__((target("sse4.2")))
+static void findSse42(const word* data, word count, word start, word size, vector<word>& indices)
+{
+    __m128i startVector = _mm_set1_epi64x((long long)start);
+    __m128i signBit = _mm_set1_epi64x(REFERENCE_SIGN_BIT);
+    __m128i sizeVector = _mm_xor_si128(_mm_set1_epi64x((long long)size), signBit);
+    word i = 0;
+
+    for (; (i + 2) <= count; i += 2)
+    {
+        //(value - start) < size <=> size > (value - start):
+        __m128i offset = _mm_xor_si128(_mm_sub_epi64(_mm_loadu_si128((const __m128i*)(data + i)), startVector), signBit);
+        int bits = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(sizeVector, offset)));
+
+        while (bits)
+        {
+            indices.push_back(i + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+
+    //The rest:
+    size_t found = indices.size();
+    findScalar(data + i, count - i, start, size, indices);
+
+    for (; found < indices.size(); found++)
+    {
+        indices[found] += i;
+    }
+}
+
+
+//AVX2 (4 words per step, unrolled twice since most blocks have no hit at all):
+__attribute__((target("avx2")))
+static void findAvx2(const word* data, word count, word start, word size, vector<word>& indices)
+{
+    __m256i startVector = _mm256_set1_epi64x((long long)start);
+    __m256i signBit = _mm256_set1_epi64x(REFERENCE_SIGN_BIT);
+    __m256i sizeVector = _mm256_xor_si256(_mm256_set1_epi64x((long long)size), signBit);
+    word i = 0;
+
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m256i first = _mm256_xor_si256(_mm256_sub_epi64(_mm256_loadu_si256((const __m256i*)(data + i)), startVector), signBit);
+        __m256i second = _mm256_xor_si256(_mm256_sub_epi64(_mm256_loadu_si256((const __m256i*)(data + i + 4)), startVector), signBit);
+        int bits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(sizeVector, first))) | (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(sizeVector, second))) << 4);
+
+        while (bits)
+        {
+            indices.push_back(i + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+
+    //The rest:
+    size_t found = indices.size();
+    findScalar(data + i, count - i, start, size, indices);
+
+    for (; found < indices.size(); found++)
+    {
+        indices[found] += i;
+    }
+}
+
+#endif
+
+
+//Select the best kernel for this CPU:
+static ReferenceKernel selectKernel()
+{
+#ifdef __amd64__
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return findAvx2;
+    }
+
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return findSse42;
+    }
+#endif
+
+    return findScalar;
+}
+
+
+ReferenceScanner::ReferenceScanner(word start, word end)
+    : start(start), end(end)
+{
+
+}
+
+
+void ReferenceScanner::find(const word* data, word count, vector<word>& indices) const
+{
+    static const ReferenceKernel kernel = selectKernel();
+
+    kernel(data, count, this->start, this->end - this->start, indices);
+}
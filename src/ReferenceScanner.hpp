@@ -0,0 +1,31 @@
+#ifndef REFERENCESCANNER_H
+#define REFERENCESCANNER_H
+
+#include <vector>
+
+#include "Globals.hpp"
+
+using namespace std;
+
+//Finds the words pointing into an address range.
+//The range check is one subtraction and one unsigned compare, done for 4 resp. 2 words at once (AVX2 resp. SSE4.2 on AMD64):
+class ReferenceScanner
+{
+    //Members:
+private:
+
+    //The range (end is exclusive):
+    word start;
+    word end;
+
+public:
+
+    //Constructor:
+    ReferenceScanner(word start, word end);
+
+    //Find all words of a buffer pointing into the range.
+    //The indices of the words are appended:
+    void find(const word* data, word count, vector<word>& indices) const;
+};
+
+#endif // REFERENCESCANNER_H
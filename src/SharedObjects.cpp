@@ -0,0 +1,279 @@
+#include "SharedObjects.hpp"
+
+#include <limits.h>
+#include <link.h>
+#include <stdexcept>
+#include <string.h>
+
+#include "SymbolTable.hpp"
+#include "Tracee.hpp"
+
+//Stop walking a (maybe corrupted) list of loaded objects after that many entries:
+#define SHARED_OBJECTS_MAX_COUNT 4096
+
+SharedObjects::SharedObjects(Tracee& tracee)
+    : tracee(tracee), debugAddress(0), breakpointAddress(0), listAvailable(false)
+{
+
+}
+
+
+SharedObjects::~SharedObjects()
+{
+    clear();
+}
+
+
+void SharedObjects::clear()
+{
+    for (vector<SharedObject>::iterator it = this->objects.begin(); it != this->objects.end(); ++it)
+    {
+        delete it->symbols;
+    }
+
+    this->objects.clear();
+}
+
+
+string SharedObjects::readString(word address)
+{
+    string result;
+    char buffer[256];
+
+    while (result.size() < PATH_MAX)
+    {
+        int count = this->tracee.readMemory((pword)(address + result.size()), sizeof(buffer), (pbyte)buffer);
+        size_t length = strnlen(buffer, count);
+
+        result.append(buffer, length);
+
+        //Terminated or unreadable:
+        if ((length < (size_t)count) || (count < (int)sizeof(buffer)))
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+string SharedObjects::findMappingPath(word address)
+{
+    const MemoryRegion* region = this->tracee.getMemoryMap().findRegion(address);
+
+    return (region && (region->start == address)) ? region->path : "";
+}
+
+
+void SharedObjects::initialize()
+{
+    clear();
+
+    this->debugAddress = 0;
+    this->breakpointAddress = 0;
+    this->listAvailable = false;
+
+    //The dynamic linker is mapped at AT_BASE (there is none for static executables):
+    word base = 0;
+
+    if (!this->tracee.getAuxiliaryValue(AT_BASE, base) || (base == 0))
+    {
+        return;
+    }
+
+    string path = findMappingPath(base);
+
+    if (path.empty())
+    {
+        return;
+    }
+
+    //Its exported symbols lead to its interface (r_debug is still empty right after exec):
+    try
+    {
+        SymbolTable linker(path);
+        const Symbol* debug = linker.find("_r_debug");
+        const Symbol* debugState = linker.find("_dl_debug_state");
+
+        if (debug)
+        {
+            this->debugAddress = base + debug->address;
+        }
+
+        if (debugState)
+        {
+            this->breakpointAddress = base + debugState->address;
+        }
+    }
+    catch (const runtime_error& err)
+    {
+        //No shared library support then.
+    }
+}
+
+
+int SharedObjects::update()
+{
+    if (this->debugAddress == 0)
+    {
+        return 0;
+    }
+
+    //Only a consistent list can be walked:
+    struct r_debug debug;
+
+    if ((this->tracee.readMemory((pword)this->debugAddress, sizeof(debug), (pbyte)&debug) != sizeof(debug)) || (debug.r_state != r_debug::RT_CONSISTENT))
+    {
+        return 0;
+    }
+
+    //The dynamic linker tells us where it reports changes:
+    if (debug.r_brk)
+    {
+        this->breakpointAddress = debug.r_brk;
+    }
+
+    this->listAvailable = (debug.r_map != NULL);
+
+    //Walk the list of loaded objects:
+    vector<SharedObject> current;
+    word entry = (word)debug.r_map;
+
+    for (int i = 0; (entry != 0) && (i < SHARED_OBJECTS_MAX_COUNT); i++)
+    {
+        struct link_map map;
+
+        if (this->tracee.readMemory((pword)entry, sizeof(map), (pbyte)&map) != sizeof(map))
+        {
+            break;
+        }
+
+        //The executable has no name and the vDSO has no file:
+        string path = map.l_name ? readString((word)map.l_name) : "";
+
+        if (path.find('/') != string::npos)
+        {
+            SharedObject object;
+            object.linkMap = entry;
+            object.path = path;
+            object.bias = map.l_addr;
+            object.low = 0;
+            object.high = 0;
+            object.symbols = NULL;
+
+            current.push_back(object);
+        }
+
+        entry = (word)map.l_next;
+    }
+
+    //Take over the objects we know already, the others are loaded:
+    vector<size_t> newObjects;
+
+    for (size_t i = 0; i < current.size(); i++)
+    {
+        for (vector<SharedObject>::iterator it = this->objects.begin(); it != this->objects.end(); ++it)
+        {
+            if ((it->symbols != NULL) && (it->linkMap == current[i].linkMap) && (it->bias == current[i].bias) && (it->path == current[i].path))
+            {
+                current[i] = *it;
+                it->symbols = NULL;
+
+                break;
+            }
+        }
+
+        if (current[i].symbols == NULL)
+        {
+            newObjects.push_back(i);
+        }
+    }
+
+    //Load the new ones in parallel:
+    vector<function<void()> > tasks;
+
+    for (vector<size_t>::iterator it = newObjects.begin(); it != newObjects.end(); ++it)
+    {
+        SharedObject* object = &current[*it];
+
+        tasks.push_back([object]()
+        {
+            try
+            {
+                object->symbols = new SymbolTable(object->path);
+            }
+            catch (...)
+            {
+                object->symbols = NULL;
+            }
+        });
+    }
+
+    this->pool.run(tasks);
+
+    //Get the address ranges of the new ones:
+    int loadedCount = 0;
+
+    for (vector<size_t>::iterator it = newObjects.begin(); it != newObjects.end(); ++it)
+    {
+        SharedObject& object = current[*it];
+
+        if (!object.symbols)
+        {
+            continue;
+        }
+
+        if (object.symbols->getAddressRange(object.low, object.high))
+        {
+            object.low += object.bias;
+            object.high += object.bias;
+        }
+
+        loadedCount++;
+    }
+
+    //Drop the unloaded ones and keep the list in link order (that's the order of symbol resolution):
+    clear();
+
+    for (vector<SharedObject>::iterator it = current.begin(); it != current.end(); ++it)
+    {
+        if (it->symbols)
+        {
+            this->objects.push_back(*it);
+        }
+    }
+
+    return loadedCount;
+}
+
+
+bool SharedObjects::findSymbol(const string& name, word& address) const
+{
+    for (vector<SharedObject>::const_iterator it = this->objects.begin(); it != this->objects.end(); ++it)
+    {
+        const Symbol* symbol = it->symbols->find(name);
+
+        if (symbol)
+        {
+            address = symbol->address + it->bias;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool SharedObjects::lookup(word address, const char*& name, word& offset) const
+{
+    for (vector<SharedObject>::const_iterator it = this->objects.begin(); it != this->objects.end(); ++it)
+    {
+        if ((address >= it->low) && (address < it->high))
+        {
+            return it->symbols->lookup(address - it->bias, name, offset);
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,109 @@
+#ifndef SHAREDOBJECTS_H
+#define SHAREDOBJECTS_H
+
+#include <string>
+#include <vector>
+
+#include "Globals.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+class SymbolTable;
+class Tracee;
+
+//A shared object loaded into the debugged process:
+struct SharedObject
+{
+    //The address of its link_map entry in the debugged process:
+    word linkMap;
+
+    //The path of the file:
+    string path;
+
+    //The load bias (runtime address = link time address + bias):
+    word bias;
+
+    //The runtime address range covered by its symbols:
+    word low;
+    word high;
+
+    //Its symbols:
+    SymbolTable* symbols;
+};
+
+class SharedObjects
+{
+    //Members:
+private:
+
+    //A reference to the tracee:
+    Tracee& tracee;
+
+    //The address of the dynamic linker's r_debug structure (0 if unknown):
+    word debugAddress;
+
+    //The address of _dl_debug_state(), called by the dynamic linker on every change (0 if unknown):
+    word breakpointAddress;
+
+    //Has the dynamic linker filled in the list of loaded objects (it's still empty right after exec)?
+    bool listAvailable;
+
+    //The loaded objects in link order (that's the order of symbol resolution):
+    vector<SharedObject> objects;
+
+    //Loads the symbol tables in parallel:
+    ThreadPool pool;
+
+    //Methods:
+private:
+
+    //Read a zero terminated string from the debugged process:
+    string readString(word address);
+
+    //Find the path of the mapping starting at an address (empty if there is none):
+    string findMappingPath(word address);
+
+    //Free all objects:
+    void clear();
+
+public:
+
+    //Get the address to break at for changes (0 if unknown):
+    inline word getBreakpointAddress() const { return this->breakpointAddress; }
+
+    //Has the list of loaded objects been read (false until the dynamic linker has filled it in)?
+    inline bool isListAvailable() const { return this->listAvailable; }
+
+    //Get the objects:
+    inline const vector<SharedObject>& getObjects() const { return this->objects; }
+
+    //Constructor:
+    SharedObjects(Tracee& tracee);
+
+    //Not copyable (it owns the symbol tables):
+    SharedObjects(const SharedObjects&) = delete;
+    SharedObjects& operator=(const SharedObjects&) = delete;
+
+    //Destructor:
+    virtual ~SharedObjects();
+
+    //Locate the dynamic linker's interface (the process must be stopped).
+    //This works right after exec as well, before any library is loaded:
+    void initialize();
+
+    //Walk the list of loaded objects and load the symbols of new ones (the process must be stopped).
+    //This returns the number of newly loaded objects:
+    int update();
+
+    //Wait until the symbols are not loaded on any thread (e.g. before forking):
+    inline void waitIdle() { this->pool.waitIdle(); }
+
+    //Find a symbol by name and get its runtime address:
+    bool findSymbol(const string& name, word& address) const;
+
+    //Find the symbol containing a runtime address (the name stays valid until the next update):
+    bool lookup(word address, const char*& name, word& offset) const;
+};
+
+#endif // SHAREDOBJECTS_H
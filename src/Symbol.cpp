@@ -1,7 +0,0 @@
-#include "Symbol.hpp"
-
-Symbol::Symbol(string name, pword address)
-    : name(name), address(address)
-{
-
-}
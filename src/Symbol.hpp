@@ -1,28 +1,25 @@
 #ifndef SYMBOL_H
 #define SYMBOL_H
 
-#include <string>
+#include <stdint.h>
 
 #include "Globals.hpp"
 
 using namespace std;
 
-class Symbol
+//A symbol.
+//This is a plain view into its symbol table, the name lives in the name arena of the table:
+struct Symbol
 {
-    //The name of the symbol:
-    string name;
-
     //The address of the symbol:
-    pword address;
+    word address;
 
-public:
+    //The offset of the name within the name arena and its hash:
+    uint32_t nameOffset;
+    uint32_t nameHash;
 
     //Getters:
-    inline string getName() const { return this->name; }
-    inline pword getAddress() const { return this->address; }
-
-    //Constructor:
-    Symbol(string name, pword address);
+    inline pword getAddress() const { return (pword)this->address; }
 };
 
 #endif // SYMBOL_H
@@ -3,24 +3,315 @@
 #define PACKAGE 1
 #define PACKAGE_VERSION 1
 #include <bfd.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <link.h>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
+#include <unordered_map>
+
+#include "ElfImage.hpp"
+
+//The symbol info accessors matching our architecture:
+#ifdef __i386__
+#define ELF_NATIVE_ST_TYPE ELF32_ST_TYPE
+#define ELF_NATIVE_ST_BIND ELF32_ST_BIND
+#elif __amd64__
+#define ELF_NATIVE_ST_TYPE ELF64_ST_TYPE
+#define ELF_NATIVE_ST_BIND ELF64_ST_BIND
+#endif
+
+//The identification of cache files and the sizes of their entries (a file written for another layout is ignored):
+#define SYMBOL_CACHE_MAGIC "LDBSYMS"
+#define SYMBOL_CACHE_LAYOUT ((uint32_t)(sizeof(word) | (sizeof(Symbol) << 8) | (sizeof(SymbolAddressEntry) << 16)))
+
+//The header of a cache file.
+//All parts are located by offsets from the start of the file, so it can be mapped anywhere and used as is:
+struct SymbolCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+
+    //The key (describing the binary the table belongs to):
+    uint64_t keyOffset;
+    uint64_t keySize;
+
+    //The storage of the table:
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t symbolsOffset;
+    uint64_t symbolCount;
+    uint64_t bucketsOffset;
+    uint64_t bucketCount;
+    uint64_t addressOffset;
+    uint64_t addressCount;
+};
+
+//The address index is sorted by address, global symbols first (they win over local aliases):
+static bool compareAddressEntries(const SymbolAddressEntry& a, const SymbolAddressEntry& b)
+{
+    if (a.address != b.address)
+    {
+        return a.address < b.address;
+    }
+
+    return a.global > b.global;
+}
+
+
+static bool equalAddresses(const SymbolAddressEntry& a, const SymbolAddressEntry& b)
+{
+    return a.address == b.address;
+}
+
+
+//Serializes all use of libbfd:
+static mutex bfdLock;
+
+//Is a part of a cache file (count elements of a size at an offset) inside of it?
+static bool isInsideCache(uint64_t offset, uint64_t count, size_t elementSize, size_t fileSize)
+{
+    return ((offset % 8) == 0) && (offset <= fileSize) && (count <= ((fileSize - offset) / elementSize));
+}
+
+
+//Check the contents of a mapped cache once, so a corrupt file can neither be read out of bounds nor hang the probing:
+static bool isCacheContentValid(const char* data, const SymbolCacheHeader* header)
+{
+    const Symbol* symbols = (const Symbol*)(data + header->symbolsOffset);
+    const uint32_t* buckets = (const uint32_t*)(data + header->bucketsOffset);
+    const SymbolAddressEntry* addresses = (const SymbolAddressEntry*)(data + header->addressOffset);
+
+    //The names are zero terminated up to the end of the arena, so any offset inside of it is safe:
+    for (uint64_t i = 0; i < header->symbolCount; i++)
+    {
+        if (symbols[i].nameOffset >= header->namesSize)
+        {
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < header->addressCount; i++)
+    {
+        if (addresses[i].nameOffset >= header->namesSize)
+        {
+            return false;
+        }
+    }
+
+    //Every bucket is free or holds a symbol (index + 1), at least one must be free to end the probing:
+    if (header->symbolCount == 0)
+    {
+        return true;
+    }
+
+    bool freeBucket = false;
+
+    for (uint64_t i = 0; i < header->bucketCount; i++)
+    {
+        if (buckets[i] > header->symbolCount)
+        {
+            return false;
+        }
+
+        freeBucket = freeBucket || (buckets[i] == 0);
+    }
+
+    return freeBucket;
+}
+
+
+//Write a buffer completely and pad the file to the next 8 byte boundary:
+static bool writeCachePart(int file, const void* data, size_t size, uint64_t& offset)
+{
+    static const char padding[8] = { 0 };
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t count = write(file, (const char*)data + written, size - written);
+
+        if (count <= 0)
+        {
+            return false;
+        }
+
+        written += count;
+    }
+
+    offset += size;
+
+    size_t paddingSize = (8 - (offset % 8)) % 8;
+
+    if (paddingSize && (write(file, padding, paddingSize) != (ssize_t)paddingSize))
+    {
+        return false;
+    }
+
+    offset += paddingSize;
+    return true;
+}
 
 SymbolTable::~SymbolTable()
 {
-    //Free the symbols:
-    for (SymbolTableMap::iterator it = this->table.begin(); it != this->table.end(); ++it)
+    //Unmap the cache file:
+    if (this->cacheMapping)
     {
-        delete it->second;
+        munmap(this->cacheMapping, this->cacheMappingSize);
+        this->cacheMapping = NULL;
     }
 
-    this->table.clear();
+    //Unmap the binary:
+    if (this->image)
+    {
+        delete this->image;
+        this->image = NULL;
+    }
+}
+
+
+SymbolTable::SymbolTable()
+    : image(NULL), namesData(NULL), namesSize(0), symbolsData(NULL), symbolCount(0), bucketsData(NULL), bucketCount(0), addressData(NULL), addressCount(0), cacheMapping(NULL), cacheMappingSize(0)
+{
+
 }
 
 
 SymbolTable::SymbolTable(string path)
+    : image(NULL), namesData(NULL), namesSize(0), symbolsData(NULL), symbolCount(0), bucketsData(NULL), bucketCount(0), addressData(NULL), addressCount(0), cacheMapping(NULL), cacheMappingSize(0)
 {
+    //Map the binary, it identifies the cache file and its symbols are read in place:
+    try
+    {
+        this->image = new ElfImage(path);
+    }
+    catch (const runtime_error& err)
+    {
+        //No ELF file for this architecture, libbfd has to handle it.
+    }
+
+    //Use the cache file if there is a matching one:
+    string cachePath;
+    string key;
+    bool cacheable = getCachePath(path, cachePath, key);
+
+    if (cacheable && mapCache(cachePath, key))
+    {
+        delete this->image;
+        this->image = NULL;
+
+        return;
+    }
+
+    //Parse the ELF symbol tables in place, fall back to libbfd:
+    if (!this->image || !parseElf())
+    {
+        delete this->image;
+        this->image = NULL;
+
+        parseBfd(path);
+    }
+
+    //Use the vectors:
+    this->symbolsData = this->symbols.data();
+    this->symbolCount = this->symbols.size();
+    this->bucketsData = this->nameBuckets.data();
+    this->bucketCount = this->nameBuckets.size();
+    this->addressData = this->addressIndex.data();
+    this->addressCount = this->addressIndex.size();
+
+    //Cache it for the next time:
+    if (cacheable)
+    {
+        writeCache(cachePath, key);
+    }
+}
+
+
+bool SymbolTable::parseElf()
+{
+    //The names are addressed by 32 bit offsets into the file:
+    if (this->image->getSize() > UINT32_MAX)
+    {
+        return false;
+    }
+
+    vector<ElfImageSymbolSection> sections = this->image->getSymbolSections();
+
+    if (sections.empty())
+    {
+        return false;
+    }
+
+    //The names stay where they are:
+    this->namesData = (const char*)this->image->getData();
+    this->namesSize = this->image->getSize();
+
+    //Size the tables once:
+    size_t totalCount = 0;
+
+    for (vector<ElfImageSymbolSection>::iterator it = sections.begin(); it != sections.end(); ++it)
+    {
+        totalCount += it->count;
+    }
+
+    this->symbols.reserve(totalCount);
+    prepareBuckets(totalCount);
+
+    //Walk the tables:
+    for (vector<ElfImageSymbolSection>::iterator it = sections.begin(); it != sections.end(); ++it)
+    {
+        const ElfW(Sym)* entries = (const ElfW(Sym)*)it->symbols;
+
+        //The first entry is always the null symbol:
+        for (word i = 1; i < it->count; i++)
+        {
+            const ElfW(Sym)& entry = entries[i];
+
+            //Skip undefined symbols (e.g. imports) and nameless ones:
+            if ((entry.st_shndx == SHN_UNDEF) || (entry.st_name == 0) || (entry.st_name >= it->stringsSize))
+            {
+                continue;
+            }
+
+            //The name must be terminated within the string table:
+            word maxLength = it->stringsSize - entry.st_name;
+            size_t length = strnlen(this->namesData + it->stringsOffset + entry.st_name, maxLength);
+
+            if (length == maxLength)
+            {
+                continue;
+            }
+
+            //Only code and data symbols are looked up by address:
+            int type = ELF_NATIVE_ST_TYPE(entry.st_info);
+            bool indexed = (type != STT_SECTION) && (type != STT_FILE) && (type != STT_TLS) && (entry.st_value != 0);
+
+            addSymbol(it->stringsOffset + entry.st_name, length, entry.st_value, entry.st_size, indexed, ELF_NATIVE_ST_BIND(entry.st_info) == STB_GLOBAL);
+        }
+    }
+
+    //Prepare the address index:
+    finishAddressIndex();
+
+    return true;
+}
+
+
+void SymbolTable::parseBfd(string path)
+{
+    //libbfd is not thread-safe:
+    lock_guard<mutex> lock(bfdLock);
+
     //Open the file as binary file descriptor:
     bfd* descr = bfd_openr(path.c_str(), NULL);
 
@@ -73,6 +364,23 @@ SymbolTable::SymbolTable(string path)
         throw runtime_error("Failed to read the number of symbols in the symbol table.");
     }
 
+    //Size the arena and the hash table once:
+    size_t totalNamesSize = 0;
+
+    for (int i = 0; i < symbolTableCount; i++)
+    {
+        if (symbolTable[i]->name)
+        {
+            totalNamesSize += strlen(bfd_asymbol_name(symbolTable[i])) + 1;
+        }
+    }
+
+    //The arena never grows beyond that, so the names stay where they are:
+    this->names.reserve(totalNamesSize);
+    this->namesData = this->names.data();
+    this->symbols.reserve(symbolTableCount);
+    prepareBuckets(symbolTableCount);
+
     //Iterate:
     for (int i = 0; i < symbolTableCount; i++)
     {
@@ -82,19 +390,480 @@ SymbolTable::SymbolTable(string path)
             continue;
         }
 
-        //Get the symbol data:
-        Symbol* newSymbol = new Symbol(string(bfd_asymbol_name(symbolTable[i])), (pword)bfd_asymbol_value(symbolTable[i]));
+        //Only defined code and data symbols are looked up by address:
+        flagword flags = symbolTable[i]->flags;
+        bool indexed = !(flags & (BSF_SECTION_SYM | BSF_FILE | BSF_DEBUGGING)) && !bfd_is_und_section(symbolTable[i]->section) && (bfd_asymbol_value(symbolTable[i]) != 0);
 
-        //Check:
-        if (!newSymbol)
+        //Copy the name into the arena (and drop it again if the name is known already):
+        const char* name = bfd_asymbol_name(symbolTable[i]);
+        size_t length = strlen(name);
+        uint32_t nameOffset = this->names.size();
+        size_t knownCount = this->symbols.size();
+
+        this->names.insert(this->names.end(), name, name + length + 1);
+        addSymbol(nameOffset, length, (word)bfd_asymbol_value(symbolTable[i]), 0, indexed, (flags & BSF_GLOBAL) != 0);
+
+        if (this->symbols.size() == knownCount)
         {
-            throw runtime_error("Failed to allocate space for a symbol.");
+            this->names.resize(nameOffset);
         }
-
-        this->table[newSymbol->getName()] = newSymbol;
     }
 
+    this->namesSize = this->names.size();
+
     //Close the file descriptor and free the table:
     bfd_close(descr);
     free(symbolTable);
+
+    //Prepare the address index:
+    finishAddressIndex();
+}
+
+
+void SymbolTable::prepareBuckets(size_t count)
+{
+    //At most half of the buckets are used:
+    size_t bucketCount = 16;
+
+    while (bucketCount < (2 * count))
+    {
+        bucketCount *= 2;
+    }
+
+    this->nameBuckets.assign(bucketCount, 0);
+}
+
+
+uint32_t SymbolTable::hashName(const char* name, size_t length)
+{
+    //FNV-1a:
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+uint32_t& SymbolTable::findBucket(const char* name, size_t length, uint32_t hash)
+{
+    //Linear probing (the table is never full):
+    size_t mask = this->nameBuckets.size() - 1;
+
+    for (size_t bucket = hash & mask; ; bucket = (bucket + 1) & mask)
+    {
+        uint32_t& entry = this->nameBuckets[bucket];
+
+        if (entry == 0)
+        {
+            return entry;
+        }
+
+        const Symbol& symbol = this->symbols[entry - 1];
+
+        if ((symbol.nameHash == hash) && (strncmp(this->namesData + symbol.nameOffset, name, length + 1) == 0))
+        {
+            return entry;
+        }
+    }
+}
+
+
+void SymbolTable::addSymbol(uint32_t nameOffset, size_t length, word address, word size, bool indexed, bool global)
+{
+    const char* name = this->namesData + nameOffset;
+    uint32_t hash = hashName(name, length);
+    uint32_t& bucket = findBucket(name, length, hash);
+
+    //Known name: Take over the symbol (and refer to the name stored with it):
+    if (bucket != 0)
+    {
+        this->symbols[bucket - 1].address = address;
+        nameOffset = this->symbols[bucket - 1].nameOffset;
+    }
+    else
+    {
+        Symbol symbol;
+        symbol.address = address;
+        symbol.nameOffset = nameOffset;
+        symbol.nameHash = hash;
+
+        this->symbols.push_back(symbol);
+        bucket = this->symbols.size();
+    }
+
+    //Add it to the address index:
+    if (indexed)
+    {
+        SymbolAddressEntry entry;
+        entry.address = address;
+        entry.size = size;
+        entry.nameOffset = nameOffset;
+        entry.global = global ? 1 : 0;
+
+        this->addressIndex.push_back(entry);
+    }
+}
+
+
+void SymbolTable::finishAddressIndex()
+{
+    //Sort and keep only one symbol per address:
+    sort(this->addressIndex.begin(), this->addressIndex.end(), compareAddressEntries);
+    this->addressIndex.erase(unique(this->addressIndex.begin(), this->addressIndex.end(), equalAddresses), this->addressIndex.end());
+    this->addressIndex.shrink_to_fit();
+
+    //Symbols without a size reach up to the next one (the last one only covers its own address):
+    for (unsigned int i = 0; (i + 1) < this->addressIndex.size(); i++)
+    {
+        if (this->addressIndex[i].size == 0)
+        {
+            this->addressIndex[i].size = this->addressIndex[i + 1].address - this->addressIndex[i].address;
+        }
+    }
+
+    if (!this->addressIndex.empty() && (this->addressIndex.back().size == 0))
+    {
+        this->addressIndex.back().size = 1;
+    }
+}
+
+
+bool SymbolTable::getCachePath(const string& path, string& cachePath, string& key) const
+{
+    //The cache directory:
+    const char* cacheHome = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    string directory;
+
+    if (cacheHome && (cacheHome[0] == '/'))
+    {
+        directory = cacheHome;
+    }
+    else if (home && (home[0] == '/'))
+    {
+        directory = string(home) + "/.cache";
+    }
+    else
+    {
+        return false;
+    }
+
+    //The size is part of every key (e.g. a stripped copy keeps the build-id of the original):
+    struct stat status;
+
+    if (stat(path.c_str(), &status))
+    {
+        return false;
+    }
+
+    //Prefer the build-id, it survives copying and touching the binary:
+    string buildId = this->image ? this->image->getBuildId() : "";
+
+    ostringstream keyStream;
+    ostringstream nameStream;
+
+    if (!buildId.empty())
+    {
+        keyStream << "build-id " << buildId << " size " << status.st_size;
+        nameStream << buildId << "-" << hex << status.st_size;
+    }
+    else
+    {
+        char realPath[PATH_MAX];
+
+        if (!realpath(path.c_str(), realPath))
+        {
+            return false;
+        }
+
+        keyStream << "path " << realPath << " mtime " << status.st_mtim.tv_sec << "." << status.st_mtim.tv_nsec << " size " << status.st_size;
+
+        //FNV-1a (64 bit) of the key as file name:
+        uint64_t hash = 14695981039346656037ULL;
+        string pathKey = keyStream.str();
+
+        for (size_t i = 0; i < pathKey.size(); i++)
+        {
+            hash = (hash ^ (uint8_t)pathKey[i]) * 1099511628211ULL;
+        }
+
+        nameStream << "path-" << hex << hash;
+    }
+
+    //Create the directories (if they exist already, this fails harmlessly):
+    mkdir(directory.c_str(), 0700);
+    directory += "/lightdbg";
+    mkdir(directory.c_str(), 0700);
+
+    cachePath = directory + "/" + nameStream.str() + ".symbols";
+    key = keyStream.str();
+
+    return true;
+}
+
+
+bool SymbolTable::mapCache(const string& cachePath, const string& key)
+{
+    //Open and map the file:
+    int file = open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+
+    if (fstat(file, &status) || (status.st_size < (off_t)sizeof(SymbolCacheHeader)))
+    {
+        close(file);
+        return false;
+    }
+
+    size_t size = status.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    //Check the header, the parts, the key and the offsets inside (nothing is parsed, the table is used in place):
+    const char* data = (const char*)mapping;
+    const SymbolCacheHeader* header = (const SymbolCacheHeader*)mapping;
+
+    bool valid = !memcmp(header->magic, SYMBOL_CACHE_MAGIC, sizeof(header->magic)) && (header->version == SYMBOL_CACHE_VERSION) && (header->layout == SYMBOL_CACHE_LAYOUT)
+        && isInsideCache(header->keyOffset, header->keySize, 1, size) && isInsideCache(header->namesOffset, header->namesSize, 1, size)
+        && isInsideCache(header->symbolsOffset, header->symbolCount, sizeof(Symbol), size) && isInsideCache(header->bucketsOffset, header->bucketCount, sizeof(uint32_t), size)
+        && isInsideCache(header->addressOffset, header->addressCount, sizeof(SymbolAddressEntry), size)
+        && (header->keySize == key.size()) && !memcmp(data + header->keyOffset, key.data(), key.size())
+        && ((header->symbolCount == 0) || ((header->bucketCount > header->symbolCount) && !(header->bucketCount & (header->bucketCount - 1))))
+        && ((header->namesSize == 0) || (data[header->namesOffset + header->namesSize - 1] == 0))
+        && isCacheContentValid(data, header);
+
+    if (!valid)
+    {
+        munmap(mapping, size);
+        return false;
+    }
+
+    this->cacheMapping = mapping;
+    this->cacheMappingSize = size;
+
+    this->namesData = data + header->namesOffset;
+    this->namesSize = header->namesSize;
+    this->symbolsData = (const Symbol*)(data + header->symbolsOffset);
+    this->symbolCount = header->symbolCount;
+    this->bucketsData = (const uint32_t*)(data + header->bucketsOffset);
+    this->bucketCount = header->bucketCount;
+    this->addressData = (const SymbolAddressEntry*)(data + header->addressOffset);
+    this->addressCount = header->addressCount;
+
+    return true;
+}
+
+
+void SymbolTable::writeCache(const string& cachePath, const string& key) const
+{
+    //Write a temporary file and rename it, so a concurrent session never maps a partial file:
+    string temporaryPath = cachePath + ".tmp" + to_string(getpid());
+    int file = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+    if (file < 0)
+    {
+        return;
+    }
+
+    //Names read in place from the binary get an arena of their own (the cache must not depend on the binary):
+    const char* namesPart = this->namesData;
+    size_t namesPartSize = this->namesSize;
+    const Symbol* symbolsPart = this->symbolsData;
+    const SymbolAddressEntry* addressPart = this->addressData;
+
+    vector<char> compactNames;
+    vector<Symbol> compactSymbols;
+    vector<SymbolAddressEntry> compactAddresses;
+
+    if (this->image)
+    {
+        unordered_map<uint32_t, uint32_t> nameOffsets(this->symbolCount);
+        compactSymbols.assign(this->symbolsData, this->symbolsData + this->symbolCount);
+        compactAddresses.assign(this->addressData, this->addressData + this->addressCount);
+
+        for (unsigned int i = 0; i < compactSymbols.size(); i++)
+        {
+            const char* name = this->namesData + compactSymbols[i].nameOffset;
+            uint32_t nameOffset = compactNames.size();
+
+            compactNames.insert(compactNames.end(), name, name + strlen(name) + 1);
+            nameOffsets[compactSymbols[i].nameOffset] = nameOffset;
+            compactSymbols[i].nameOffset = nameOffset;
+        }
+
+        //The address index only refers to names of symbols:
+        for (unsigned int i = 0; i < compactAddresses.size(); i++)
+        {
+            compactAddresses[i].nameOffset = nameOffsets[compactAddresses[i].nameOffset];
+        }
+
+        namesPart = compactNames.data();
+        namesPartSize = compactNames.size();
+        symbolsPart = compactSymbols.data();
+        addressPart = compactAddresses.data();
+    }
+
+    //Lay out the parts one after another:
+    SymbolCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SYMBOL_CACHE_MAGIC, sizeof(header.magic));
+    header.version = SYMBOL_CACHE_VERSION;
+    header.layout = SYMBOL_CACHE_LAYOUT;
+
+    uint64_t offset = sizeof(header);
+    header.keyOffset = offset;
+    header.keySize = key.size();
+    offset += (key.size() + 7) & ~7ULL;
+    header.namesOffset = offset;
+    header.namesSize = namesPartSize;
+    offset += (namesPartSize + 7) & ~7ULL;
+    header.symbolsOffset = offset;
+    header.symbolCount = this->symbolCount;
+    offset += ((this->symbolCount * sizeof(Symbol)) + 7) & ~7ULL;
+    header.bucketsOffset = offset;
+    header.bucketCount = this->bucketCount;
+    offset += ((this->bucketCount * sizeof(uint32_t)) + 7) & ~7ULL;
+    header.addressOffset = offset;
+    header.addressCount = this->addressCount;
+
+    //Write them:
+    offset = 0;
+
+    bool written = writeCachePart(file, &header, sizeof(header), offset) && writeCachePart(file, key.data(), key.size(), offset)
+        && writeCachePart(file, namesPart, namesPartSize, offset) && writeCachePart(file, symbolsPart, this->symbolCount * sizeof(Symbol), offset)
+        && writeCachePart(file, this->bucketsData, this->bucketCount * sizeof(uint32_t), offset) && writeCachePart(file, addressPart, this->addressCount * sizeof(SymbolAddressEntry), offset);
+
+    if (close(file) || !written || rename(temporaryPath.c_str(), cachePath.c_str()))
+    {
+        unlink(temporaryPath.c_str());
+    }
+}
+
+
+const Symbol* SymbolTable::find(const string& name) const
+{
+    if (this->symbolCount == 0)
+    {
+        return NULL;
+    }
+
+    //The probing is the same as in findBucket(), just without a way to insert:
+    uint32_t hash = hashName(name.c_str(), name.size());
+    size_t mask = this->bucketCount - 1;
+
+    for (size_t bucket = hash & mask; this->bucketsData[bucket] != 0; bucket = (bucket + 1) & mask)
+    {
+        const Symbol& symbol = this->symbolsData[this->bucketsData[bucket] - 1];
+
+        if ((symbol.nameHash == hash) && (name.compare(this->namesData + symbol.nameOffset) == 0))
+        {
+            return &symbol;
+        }
+    }
+
+    return NULL;
+}
+
+
+const SymbolAddressEntry* SymbolTable::findAddressEntry(word address) const
+{
+    if (this->addressCount == 0)
+    {
+        return NULL;
+    }
+
+    //Branchless binary search for the last entry starting at or before the address.
+    //The loop only depends on the size, the comparison becomes a conditional move:
+    const SymbolAddressEntry* base = this->addressData;
+    size_t count = this->addressCount;
+
+    while (count > 1)
+    {
+        size_t half = count / 2;
+        base = (base[half].address <= address) ? (base + half) : base;
+        count -= half;
+    }
+
+    //Is it inside of the symbol?
+    if ((base->address > address) || ((address - base->address) >= base->size))
+    {
+        return NULL;
+    }
+
+    return base;
+}
+
+
+bool SymbolTable::lookup(word address, const char*& name, word& offset) const
+{
+    const SymbolAddressEntry* entry = findAddressEntry(address);
+
+    if (!entry)
+    {
+        return false;
+    }
+
+    name = this->namesData + entry->nameOffset;
+    offset = address - entry->address;
+
+    return true;
+}
+
+
+bool SymbolTable::getSize(word address, word& size) const
+{
+    const SymbolAddressEntry* entry = findAddressEntry(address);
+
+    if (!entry || (entry->address != address))
+    {
+        return false;
+    }
+
+    size = entry->size;
+    return true;
+}
+
+
+bool SymbolTable::getAddressRange(word& low, word& high) const
+{
+    if (this->addressCount == 0)
+    {
+        return false;
+    }
+
+    low = this->addressData[0].address;
+    high = this->addressData[this->addressCount - 1].address + this->addressData[this->addressCount - 1].size;
+
+    return true;
+}
+
+
+string SymbolTable::describe(word address) const
+{
+    const char* name = NULL;
+    word offset = 0;
+
+    if (!lookup(address, name, offset))
+    {
+        return "";
+    }
+
+    ostringstream description;
+    description << name << "+0x" << hex << offset;
+
+    return description.str();
 }
@@ -1,35 +1,144 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
-#include <map>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "Globals.hpp"
 #include "Symbol.hpp"
 
+//The version of the cache file layout (increment it whenever the layout or the parsing changes):
+#define SYMBOL_CACHE_VERSION 2
+
 using namespace std;
 
-typedef map<string, Symbol*> SymbolTableMap;
+class ElfImage;
+
+//An entry of the address index (sorted by address):
+struct SymbolAddressEntry
+{
+    //The range covered by the symbol:
+    word address;
+    word size;
+
+    //The offset of the name within the name arena:
+    uint32_t nameOffset;
+
+    //Is it a global symbol (they win over local aliases)?
+    uint32_t global;
+};
 
 class SymbolTable
 {
     //Members:
 private:
 
-    //The table itself:
-    SymbolTableMap table;
+    //All names, zero terminated, one after another (unless they are read in place from the mapped binary):
+    vector<char> names;
+
+    //The mapped binary (as long as the names point into it):
+    ElfImage* image;
+
+    //The symbols (one per name):
+    vector<Symbol> symbols;
+
+    //The open addressing hash table over the names (symbol index + 1, 0 marks a free bucket):
+    vector<uint32_t> nameBuckets;
+
+    //The address index (only code and data symbols):
+    vector<SymbolAddressEntry> addressIndex;
+
+    //The storage in use, either the vectors above or the mapped cache file:
+    const char* namesData;
+    size_t namesSize;
+    const Symbol* symbolsData;
+    size_t symbolCount;
+    const uint32_t* bucketsData;
+    size_t bucketCount;
+    const SymbolAddressEntry* addressData;
+    size_t addressCount;
+
+    //The mapped cache file (NULL if the table has been parsed):
+    void* cacheMapping;
+    size_t cacheMappingSize;
 
     //Methods:
+private:
+
+    //Parse the symbol tables of the mapped binary in place (false if it has none):
+    bool parseElf();
+
+    //Parse the symbols of a binary with libbfd (the fallback for other formats):
+    void parseBfd(string path);
+
+    //Size the hash table for a number of symbols:
+    void prepareBuckets(size_t count);
+
+    //Hash a name:
+    static uint32_t hashName(const char* name, size_t length);
+
+    //Add a symbol whose name is stored at an offset from namesData.
+    //A later symbol with the same name replaces an earlier one, a size of 0 means up to the next symbol:
+    void addSymbol(uint32_t nameOffset, size_t length, word address, word size, bool indexed, bool global);
+
+    //Find the bucket of a name (either holding it or the free one where it belongs):
+    uint32_t& findBucket(const char* name, size_t length, uint32_t hash);
+
+    //Sort the address index and derive the sizes:
+    void finishAddressIndex();
+
+    //Find the entry of the address index containing an address (NULL if there is none):
+    const SymbolAddressEntry* findAddressEntry(word address) const;
+
+    //Get the path of the cache file of a binary and the key identifying its contents (false if the binary can't be cached):
+    bool getCachePath(const string& path, string& cachePath, string& key) const;
+
+    //Map a cache file (false if there is none or it doesn't match the key):
+    bool mapCache(const string& cachePath, const string& key);
+
+    //Write the table into a cache file (errors are ignored, the cache is optional):
+    void writeCache(const string& cachePath, const string& key) const;
+
 public:
 
-    //Get the table:
-    inline SymbolTableMap const& getMap() const { return table; }
+    //Getters:
+    inline const Symbol* begin() const { return this->symbolsData; }
+    inline const Symbol* end() const { return this->symbolsData + this->symbolCount; }
+    inline const char* getName(const Symbol& symbol) const { return this->namesData + symbol.nameOffset; }
+    inline size_t size() const { return this->symbolCount; }
+    inline bool isCached() const { return this->cacheMapping != NULL; }
+
+    //Constructor (an empty table):
+    SymbolTable();
 
-    //Constructor:
+    //Constructor (maps the cached table of the binary or parses and caches it):
     SymbolTable(string path);
 
+    //Not copyable (it may own a mapping):
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
     //Destructor:
     virtual ~SymbolTable();
+
+    //Find a symbol by name (NULL if there is none):
+    const Symbol* find(const string& name) const;
+
+    //Find the symbol containing an address.
+    //This returns false if there is none, otherwise the name and the offset within the symbol:
+    bool lookup(word address, const char*& name, word& offset) const;
+
+    //Get the size of the symbol starting at an address (its st_size, or up to the next symbol if it has none).
+    //This returns false if no symbol of the address index starts there:
+    bool getSize(word address, word& size) const;
+
+    //Get the address range covered by the address index (false if it is empty):
+    bool getAddressRange(word& low, word& high) const;
+
+    //Describe an address as "symbol+0xoffset" (empty if there is no symbol):
+    string describe(word address) const;
 };
 
 #endif // SYMBOLTABLE_H
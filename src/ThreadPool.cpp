@@ -0,0 +1,135 @@
+#include "ThreadPool.hpp"
+
+#include <system_error>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : threadCount(threadCount), pendingCount(0), sleepingCount(0), stopping(false)
+{
+    //One per CPU:
+    if (this->threadCount == 0)
+    {
+        this->threadCount = thread::hardware_concurrency();
+    }
+
+    if (this->threadCount == 0)
+    {
+        this->threadCount = 1;
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    //Wake up all workers and let them leave:
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+
+    this->taskQueued.notify_all();
+
+    for (vector<thread>::iterator it = this->workers.begin(); it != this->workers.end(); ++it)
+    {
+        it->join();
+    }
+}
+
+
+void ThreadPool::work()
+{
+    unique_lock<mutex> guard(this->lock);
+
+    while (true)
+    {
+        //Wait for a task (the last one falling asleep wakes up waitIdle()):
+        while (this->tasks.empty() && !this->stopping)
+        {
+            if (++this->sleepingCount == this->workers.size())
+            {
+                this->workersSleeping.notify_all();
+            }
+
+            this->taskQueued.wait(guard);
+            this->sleepingCount--;
+        }
+
+        if (this->tasks.empty())
+        {
+            return;
+        }
+
+        function<void()> task = this->tasks.front();
+        this->tasks.pop_front();
+
+        //Run it unlocked:
+        guard.unlock();
+        task();
+        guard.lock();
+
+        //The last one wakes up the caller:
+        if (--this->pendingCount == 0)
+        {
+            this->tasksFinished.notify_all();
+        }
+    }
+}
+
+
+void ThreadPool::run(vector<function<void()> >& newTasks)
+{
+    if (newTasks.empty())
+    {
+        return;
+    }
+
+    unique_lock<mutex> guard(this->lock);
+
+    //Start the workers on first use:
+    while (this->workers.size() < this->threadCount)
+    {
+        try
+        {
+            this->workers.push_back(thread(&ThreadPool::work, this));
+        }
+        catch (const system_error& err)
+        {
+            break;
+        }
+    }
+
+    //No worker could be started, run them here:
+    if (this->workers.empty())
+    {
+        guard.unlock();
+
+        for (vector<function<void()> >::iterator it = newTasks.begin(); it != newTasks.end(); ++it)
+        {
+            (*it)();
+        }
+
+        return;
+    }
+
+    //Queue the tasks:
+    this->tasks.insert(this->tasks.end(), newTasks.begin(), newTasks.end());
+    this->pendingCount += newTasks.size();
+    this->taskQueued.notify_all();
+
+    //Wait for them:
+    while (this->pendingCount != 0)
+    {
+        this->tasksFinished.wait(guard);
+    }
+}
+
+
+void ThreadPool::waitIdle()
+{
+    unique_lock<mutex> guard(this->lock);
+
+    //Started workers sleep as well before they take their first task:
+    while ((this->pendingCount != 0) || (this->sleepingCount < this->workers.size()))
+    {
+        this->workersSleeping.wait(guard);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//Runs tasks on a set of worker threads.
+//run() waits for its tasks, so between two calls the workers only sleep waiting for new ones and hold no locks.
+//Processes must only be forked in between (after waitIdle()), a lock held by a worker would stay locked in the child:
+class ThreadPool
+{
+    //Members:
+private:
+
+    //The number of workers (they are started on first use):
+    unsigned int threadCount;
+    vector<thread> workers;
+
+    //The queued tasks and the number of unfinished ones:
+    deque<function<void()> > tasks;
+    size_t pendingCount;
+
+    //The number of workers sleeping until a task is queued:
+    size_t sleepingCount;
+
+    //Should the workers leave?
+    bool stopping;
+
+    //Guards the members above:
+    mutex lock;
+
+    //Signals new tasks, the last finished task resp. the last worker falling asleep:
+    condition_variable taskQueued;
+    condition_variable tasksFinished;
+    condition_variable workersSleeping;
+
+    //Methods:
+private:
+
+    //The loop of a worker:
+    void work();
+
+public:
+
+    //Get the number of workers:
+    inline unsigned int getThreadCount() const { return this->threadCount; }
+
+    //Constructor (0 threads means one per CPU):
+    ThreadPool(unsigned int threadCount = 0);
+
+    //Not copyable (it owns threads):
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Destructor (waits for the workers):
+    virtual ~ThreadPool();
+
+    //Run tasks on the workers and wait until all of them are finished.
+    //The tasks must not throw:
+    void run(vector<function<void()> >& newTasks);
+
+    //Wait until all workers sleep waiting for tasks (e.g. before forking):
+    void waitIdle();
+};
+
+#endif // THREADPOOL_H
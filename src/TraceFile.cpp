@@ -0,0 +1,550 @@
+#include "TraceFile.hpp"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+TraceFileWriter::TraceFileWriter(string filePath, AsyncWriterOverflow overflow, int compression)
+    : writer(NULL), blockSteps(0), lostSteps(0), lastIP(0), lastRegisters()
+{
+    //Create the file:
+    int file = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (file < 0)
+    {
+        throw runtime_error("Opening the file for writing has failed.");
+    }
+
+    this->writer = new AsyncWriter(file, overflow, compression);
+
+    //Reserve a whole block (a record never exceeds it by much):
+    this->block.reserve(TRACE_FILE_BLOCK_BYTES + 1024);
+
+    //Header (never dropped, the ring is empty):
+    byte header[TRACE_FILE_HEADER_BYTES] = { 0 };
+    memcpy(header, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_BYTES);
+    header[TRACE_FILE_MAGIC_BYTES] = TRACE_FILE_VERSION;
+    header[TRACE_FILE_MAGIC_BYTES + 1] = WORD_SIZE_BYTES;
+
+    this->writer->push(header, sizeof(header));
+}
+
+
+TraceFileWriter::~TraceFileWriter()
+{
+    //Write the rest:
+    try
+    {
+        flush();
+    }
+    catch (const runtime_error& rt)
+    {
+        //Nothing we could do about it here ...
+    }
+
+    delete this->writer;
+}
+
+
+void TraceFileWriter::appendVarint(word value)
+{
+    //7 bits per byte, the highest bit tells if more bytes follow:
+    while (value >= 0x80)
+    {
+        this->block.push_back((byte)(value | 0x80));
+        value >>= 7;
+    }
+
+    this->block.push_back((byte)value);
+}
+
+
+void TraceFileWriter::appendZigzag(long value)
+{
+    //Zigzag encoding keeps small negative values small as well:
+    appendVarint(((word)value << 1) ^ (word)(value >> (WORD_SIZE_BITS - 1)));
+}
+
+
+void TraceFileWriter::appendBytes(const void* data, word count)
+{
+    this->block.insert(this->block.end(), (const byte*)data, (const byte*)data + count);
+}
+
+
+void TraceFileWriter::pushBlock()
+{
+    if (this->block.empty())
+    {
+        return;
+    }
+
+    //Dropped? The steps of the next block must not depend on this one then:
+    if (this->writer->push(this->block.data(), this->block.size()))
+    {
+        this->lostSteps = 0;
+    }
+    else
+    {
+        this->lostSteps += this->blockSteps;
+        this->lastIP = 0;
+        memset(this->lastRegisters, 0, sizeof(this->lastRegisters));
+        this->disassembly.clear();
+    }
+
+    this->block.clear();
+    this->blockSteps = 0;
+}
+
+
+void TraceFileWriter::appendLost()
+{
+    //Only at the start of a block, the steps before are lost as well:
+    if (this->lostSteps && this->block.empty())
+    {
+        this->block.push_back(TRACE_RECORD_LOST);
+        appendVarint(this->lostSteps);
+    }
+}
+
+
+void TraceFileWriter::flush()
+{
+    appendLost();
+    pushBlock();
+    this->writer->flush();
+}
+
+
+void TraceFileWriter::appendDisassembly(word address, const Mnemonic& mnemonic)
+{
+    //Is the disassembly of this address new (or has the code changed)?
+    unordered_map<word, string>::iterator known = this->disassembly.find(address);
+
+    if ((known != this->disassembly.end()) && (known->second == mnemonic.getAssembly()))
+    {
+        return;
+    }
+
+    word length = strlen(mnemonic.getAssembly());
+
+    this->block.push_back(TRACE_RECORD_DISASSEMBLY);
+    appendVarint(address);
+    appendVarint(mnemonic.getOpcodeLength());
+    appendVarint(length);
+    appendBytes(mnemonic.getAssembly(), length);
+
+    this->disassembly[address] = mnemonic.getAssembly();
+}
+
+
+void TraceFileWriter::appendRegisterChanges(const user_regs_struct& registers)
+{
+    const word* current = (const word*)&registers;
+    word mask = getChangedRegisters(this->lastRegisters, current);
+
+    this->block.push_back(TRACE_RECORD_REGISTERS);
+    appendVarint(mask);
+
+    for (int i = 0; i < REGISTER_COUNT; i++)
+    {
+        if (mask & ((word)1 << i))
+        {
+            appendZigzag((long)(current[i] - this->lastRegisters[i]));
+            this->lastRegisters[i] = current[i];
+        }
+    }
+}
+
+
+void TraceFileWriter::trace(word ip, const Mnemonic& mnemonic, const user_regs_struct* registers)
+{
+    //Tell the reader about dropped steps first:
+    appendLost();
+    appendDisassembly(ip, mnemonic);
+
+    if (registers)
+    {
+        appendRegisterChanges(*registers);
+    }
+
+    this->block.push_back(TRACE_RECORD_IP);
+    appendZigzag((long)(ip - this->lastIP));
+
+    this->lastIP = ip;
+    this->blockSteps++;
+
+    //Full?
+    if (this->block.size() >= TRACE_FILE_BLOCK_BYTES)
+    {
+        pushBlock();
+    }
+}
+
+
+void TraceFileWriter::traceBlock(const vector<word>& addresses, const vector<Mnemonic>& mnemonics, const user_regs_struct* registers)
+{
+    //The block start, the instructions up to the branch and its target:
+    if (addresses.size() < 2)
+    {
+        return;
+    }
+
+    appendLost();
+
+    //Every instruction the reader walks over needs its length:
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        appendDisassembly(addresses[i], mnemonics[i]);
+    }
+
+    if (registers)
+    {
+        appendRegisterChanges(*registers);
+    }
+
+    //The start is the last target unless a block was dropped:
+    word start = addresses.front();
+    word source = addresses[addresses.size() - 2];
+    word target = addresses.back();
+
+    this->block.push_back(TRACE_RECORD_BRANCH);
+    appendZigzag((long)(start - this->lastIP));
+    appendZigzag((long)(source - start));
+    appendZigzag((long)(target - source));
+
+    this->lastIP = target;
+    this->blockSteps += addresses.size() - 1;
+
+    //Full?
+    if (this->block.size() >= TRACE_FILE_BLOCK_BYTES)
+    {
+        pushBlock();
+    }
+}
+
+
+TraceFileReader::TraceFileReader(string filePath)
+    : file(NULL), buffer(TRACE_FILE_BLOCK_BYTES), bufferPosition(0), bufferSize(0), wordSize(0)
+{
+    //Open the file (gzread passes uncompressed files through):
+    this->file = gzopen(filePath.c_str(), "rb");
+
+    if (!this->file)
+    {
+        throw runtime_error("Opening the trace file has failed.");
+    }
+
+    //Check the header:
+    byte header[TRACE_FILE_HEADER_BYTES];
+
+    if (!readBytes(header, sizeof(header)) || (memcmp(header, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_BYTES) != 0))
+    {
+        gzclose(this->file);
+        throw runtime_error("This is not a binary trace file.");
+    }
+
+    if (header[TRACE_FILE_MAGIC_BYTES] != TRACE_FILE_VERSION)
+    {
+        gzclose(this->file);
+        throw runtime_error("The version of the trace file is not supported.");
+    }
+
+    this->wordSize = header[TRACE_FILE_MAGIC_BYTES + 1];
+
+    if ((this->wordSize != 4) && (this->wordSize != 8))
+    {
+        gzclose(this->file);
+        throw runtime_error("The trace file has an invalid word size.");
+    }
+}
+
+
+TraceFileReader::~TraceFileReader()
+{
+    gzclose(this->file);
+}
+
+
+bool TraceFileReader::readByte(byte& value)
+{
+    //Refill the buffer:
+    if (this->bufferPosition >= this->bufferSize)
+    {
+        int result = gzread(this->file, this->buffer.data(), this->buffer.size());
+
+        if (result <= 0)
+        {
+            return false;
+        }
+
+        this->bufferPosition = 0;
+        this->bufferSize = result;
+    }
+
+    value = this->buffer[this->bufferPosition++];
+    return true;
+}
+
+
+bool TraceFileReader::readBytes(void* data, word count)
+{
+    pbyte target = (pbyte)data;
+
+    for (word i = 0; i < count; i++)
+    {
+        if (!readByte(target[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool TraceFileReader::readZigzag(word& value)
+{
+    word encoded;
+
+    if (!readVarint(encoded))
+    {
+        return false;
+    }
+
+    //Back to two's complement:
+    value = (encoded >> 1) ^ (~(encoded & 1) + 1);
+    return true;
+}
+
+
+bool TraceFileReader::readVarint(word& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < WORD_SIZE_BITS; shift += 7)
+    {
+        byte current;
+
+        if (!readByte(current))
+        {
+            return false;
+        }
+
+        value |= (word)(current & 0x7f) << shift;
+
+        if (!(current & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void TraceFileReader::dump(ostream& output, bool showRegisters)
+{
+    //The disassembly and length of each instruction:
+    unordered_map<word, pair<string, word> > disassembly;
+    word ip = 0;
+
+    //The registers and the ones that changed before the current step:
+    word registers[REGISTER_COUNT] = { 0 };
+    word changedRegisters = 0;
+
+    //Only traces of the same word size are supported:
+    if (this->wordSize > WORD_SIZE_BYTES)
+    {
+        throw runtime_error("The trace file was written on a 64 bit system.");
+    }
+
+    word mask = (this->wordSize == WORD_SIZE_BYTES) ? ~(word)0 : (((word)1 << (this->wordSize * 8)) - 1);
+
+    //The lines are collected and written in large chunks:
+    string lines;
+    lines.reserve(TRACE_FILE_BLOCK_BYTES + 1024);
+
+    char prefix[32];
+    byte type;
+
+    //Add the line of a step (the changed registers belong to the last step before the next record):
+    auto appendLine = [&](bool withRegisters)
+    {
+        snprintf(prefix, sizeof(prefix), "\t0x%0*lx\t", 2 * this->wordSize, ip);
+        lines += prefix;
+        lines += disassembly[ip].first;
+
+        if (withRegisters && showRegisters && changedRegisters)
+        {
+            appendRegisters(lines, registers, changedRegisters);
+        }
+
+        lines += '\n';
+
+        if (lines.size() >= TRACE_FILE_BLOCK_BYTES)
+        {
+            output.write(lines.data(), lines.size());
+            lines.clear();
+        }
+    };
+
+    while (readByte(type))
+    {
+        //Disassembly:
+        if (type == TRACE_RECORD_DISASSEMBLY)
+        {
+            word address;
+            word opcodeLength;
+            word length;
+
+            if (!readVarint(address) || !readVarint(opcodeLength) || !readVarint(length))
+            {
+                throw runtime_error("The trace file is truncated.");
+            }
+
+            string assembly(length, '\0');
+
+            if (!readBytes(&assembly[0], length))
+            {
+                throw runtime_error("The trace file is truncated.");
+            }
+
+            disassembly[address] = make_pair(assembly, opcodeLength);
+        }
+        //IP:
+        else if (type == TRACE_RECORD_IP)
+        {
+            word delta;
+
+            if (!readZigzag(delta))
+            {
+                throw runtime_error("The trace file is truncated.");
+            }
+
+            ip = (ip + delta) & mask;
+
+            appendLine(true);
+            changedRegisters = 0;
+        }
+        //A block up to a taken branch:
+        else if (type == TRACE_RECORD_BRANCH)
+        {
+            word startDelta;
+            word sourceDelta;
+            word targetDelta;
+
+            if (!readZigzag(startDelta) || !readZigzag(sourceDelta) || !readZigzag(targetDelta))
+            {
+                throw runtime_error("The trace file is truncated.");
+            }
+
+            //Walk from the start to the branch, every instruction after the start is a step:
+            ip = (ip + startDelta) & mask;
+            word source = (ip + sourceDelta) & mask;
+
+            while (ip != source)
+            {
+                word opcodeLength = disassembly[ip].second;
+
+                if ((opcodeLength == 0) || (((source - ip) & mask) > TRACE_FILE_BLOCK_BYTES))
+                {
+                    throw runtime_error("The trace file contains an invalid block.");
+                }
+
+                ip = (ip + opcodeLength) & mask;
+                appendLine(false);
+            }
+
+            //The target:
+            ip = (source + targetDelta) & mask;
+
+            appendLine(true);
+            changedRegisters = 0;
+        }
+        //Dropped steps (the next IP is absolute again):
+        else if (type == TRACE_RECORD_LOST)
+        {
+            word count;
+
+            if (!readVarint(count))
+            {
+                throw runtime_error("The trace file is truncated.");
+            }
+
+            lines += "\t(" + to_string(count) + " steps were dropped)\n";
+            ip = 0;
+            memset(registers, 0, sizeof(registers));
+        }
+        //Changed registers:
+        else if (type == TRACE_RECORD_REGISTERS)
+        {
+            //Their layout is the one of this arch:
+            if (this->wordSize != WORD_SIZE_BYTES)
+            {
+                throw runtime_error("The registers of a trace of another arch cannot be read.");
+            }
+
+            if (!readVarint(changedRegisters) || (changedRegisters >> REGISTER_COUNT))
+            {
+                throw runtime_error("The trace file contains an invalid register record.");
+            }
+
+            for (int i = 0; i < REGISTER_COUNT; i++)
+            {
+                if (!(changedRegisters & ((word)1 << i)))
+                {
+                    continue;
+                }
+
+                word delta;
+
+                if (!readZigzag(delta))
+                {
+                    throw runtime_error("The trace file is truncated.");
+                }
+
+                registers[i] += delta;
+            }
+        }
+        else
+        {
+            throw runtime_error("The trace file contains an unknown record.");
+        }
+    }
+
+    output.write(lines.data(), lines.size());
+    output.flush();
+}
+
+
+word getChangedRegisters(const word* previous, const word* current)
+{
+    word mask = 0;
+
+    for (int i = 0; i < REGISTER_COUNT; i++)
+    {
+        if ((i != TRACE_REGISTER_IP_INDEX) && (previous[i] != current[i]))
+        {
+            mask |= (word)1 << i;
+        }
+    }
+
+    return mask;
+}
+
+
+void appendRegisters(string& line, const word* registers, word mask)
+{
+    char text[64];
+
+    for (int i = 0; i < REGISTER_COUNT; i++)
+    {
+        if (mask & ((word)1 << i))
+        {
+            snprintf(text, sizeof(text), "\t%s=0x%lx", registerNames[i], registers[i]);
+            line += text;
+        }
+    }
+}
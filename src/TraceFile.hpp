@@ -0,0 +1,151 @@
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <iostream>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <sys/user.h>
+#include <vector>
+#include <zlib.h>
+
+#include "AsyncWriter.hpp"
+#include "Globals.hpp"
+#include "Mnemonic.hpp"
+
+//The header of a binary trace file ("LDBTRACE", version, word size, padding):
+#define TRACE_FILE_MAGIC "LDBTRACE"
+#define TRACE_FILE_MAGIC_BYTES 8
+#define TRACE_FILE_VERSION 1
+#define TRACE_FILE_HEADER_BYTES 16
+
+//The record types:
+#define TRACE_RECORD_DISASSEMBLY 'D'
+#define TRACE_RECORD_IP 'I'
+#define TRACE_RECORD_LOST 'L'
+#define TRACE_RECORD_REGISTERS 'R'
+#define TRACE_RECORD_BRANCH 'B'
+
+//The IP is part of the steps, so it is left out of the register records:
+#define TRACE_REGISTER_IP_INDEX ((int)(offsetof(struct user_regs_struct, REG_IP) / sizeof(word)))
+
+//The size of the blocks that are written at once:
+#define TRACE_FILE_BLOCK_BYTES (1024 * 1024)
+
+using namespace std;
+
+//Writes a binary trace.
+//Every step is stored as the zigzag varint delta to the previous IP ('I'),
+//the disassembly and length only once per instruction ('D', again if the code has changed).
+//With block stepping, a block is stored as its start, the taken branch and its target ('B', each a delta to the one before),
+//the steps in between are rebuilt from the lengths.
+//If registers are recorded, a step is preceded by the ones that changed ('R', a varint bitmask and the zigzag varint deltas).
+//If the writer drops a block, the next one starts over with the number of lost steps ('L'):
+class TraceFileWriter
+{
+    //Members:
+private:
+
+    //Writes the blocks on its own thread:
+    AsyncWriter* writer;
+
+    //The block that is filled right now and the number of steps in it:
+    vector<byte> block;
+    word blockSteps;
+
+    //The number of steps in dropped blocks that were not written yet:
+    word lostSteps;
+
+    //The last traced IP and registers (all zero at the start, so the first record holds all of them):
+    word lastIP;
+    word lastRegisters[REGISTER_COUNT];
+
+    //The disassembly that was written for each address:
+    unordered_map<word, string> disassembly;
+
+    //Methods:
+private:
+
+    //Append to the block:
+    void appendVarint(word value);
+    void appendZigzag(long value);
+    void appendBytes(const void* data, word count);
+
+    //Append the disassembly of an instruction if it is new:
+    void appendDisassembly(word address, const Mnemonic& mnemonic);
+
+    //Append the registers that changed:
+    void appendRegisterChanges(const user_regs_struct& registers);
+
+    //Start the block with the number of dropped steps (if there are any):
+    void appendLost();
+
+    //Hand the block over to the writer:
+    void pushBlock();
+
+public:
+
+    //Get the writer (for its statistics):
+    inline const AsyncWriter& getWriter() const { return *this->writer; }
+
+    //Constructor (creates the file and writes the header, compression is a zlib level):
+    TraceFileWriter(string filePath, AsyncWriterOverflow overflow, int compression);
+
+    //Destructor (writes what is left):
+    virtual ~TraceFileWriter();
+
+    //Add one step (registers can be NULL):
+    void trace(word ip, const Mnemonic& mnemonic, const user_regs_struct* registers);
+
+    //Add the steps of a block, from its start over the taken branch to the target (registers can be NULL):
+    void traceBlock(const vector<word>& addresses, const vector<Mnemonic>& mnemonics, const user_regs_struct* registers);
+
+    //Write the current block and wait until it is on disk:
+    void flush();
+};
+
+//Reads a binary trace (compressed or not):
+class TraceFileReader
+{
+    //Members:
+private:
+
+    //The zlib file:
+    gzFile file;
+
+    //The buffer and the read position in it:
+    vector<byte> buffer;
+    word bufferPosition;
+    word bufferSize;
+
+    //The word size of the traced process:
+    int wordSize;
+
+    //Methods:
+private:
+
+    //Read from the file (false at its end):
+    bool readByte(byte& value);
+    bool readBytes(void* data, word count);
+    bool readVarint(word& value);
+    bool readZigzag(word& value);
+
+public:
+
+    //Constructor (opens the file and checks the header):
+    TraceFileReader(string filePath);
+
+    //Destructor:
+    virtual ~TraceFileReader();
+
+    //Print the trace in the text format of the tracer (with the changed registers):
+    void dump(ostream& output, bool showRegisters);
+};
+
+//Get the mask of the registers that differ (without the IP):
+word getChangedRegisters(const word* previous, const word* current);
+
+//Append "\t<name>=0x<value>" for each register in the mask:
+void appendRegisters(string& line, const word* registers, word mask);
+
+#endif // TRACEFILE_H
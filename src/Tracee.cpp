@@ -2,14 +2,21 @@
 
 #include <algorithm>
 #include <elf.h>
+#include <fcntl.h>
+#include <fstream>
 #include <libgen.h>
+#include <limits.h>
 #include <link.h>
 #include <linux/limits.h>
 #include <signal.h>
+#include <sstream>
 #include <stdexcept>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <system_error>
 #include <unistd.h>
 
 void Tracee::assignNameAndPath(string binaryPath)
@@ -33,6 +40,53 @@ void Tracee::assignNameAndPath(string binaryPath)
 }
 
 
+void Tracee::startSymbolTableLoading()
+{
+    cout << "Loading symbol table in the background ..." << endl;
+
+    //The thread only gets its own copy of the path:
+    string binaryPath = this->path;
+
+    try
+    {
+        this->symbolTableLoader = async(launch::async, [binaryPath]() { return new SymbolTable(binaryPath); });
+    }
+    catch (const system_error& err)
+    {
+        //No thread available, it is loaded on first use instead.
+    }
+}
+
+
+SymbolTable* Tracee::getSymbolTable()
+{
+    if (this->symbolTable)
+    {
+        return this->symbolTable;
+    }
+
+    //Wait for the loader (or load it now if there is none):
+    try
+    {
+        this->symbolTable = this->symbolTableLoader.valid() ? this->symbolTableLoader.get() : new SymbolTable(this->path);
+    }
+    catch (const runtime_error& err)
+    {
+        //Go on without symbols:
+        cout << "Failed to load the symbol table: " << err.what() << endl;
+        this->symbolTable = new SymbolTable();
+    }
+
+    return this->symbolTable;
+}
+
+
+bool Tracee::isSymbolTableLoaded() const
+{
+    return this->symbolTable || (this->symbolTableLoader.valid() && (this->symbolTableLoader.wait_for(chrono::seconds(0)) == future_status::ready));
+}
+
+
 void Tracee::run(vector<string>& args)
 {
     //Read the arguments:
@@ -45,9 +99,43 @@ void Tracee::run(vector<string>& args)
     assignNameAndPath(args[0]);
     cout << "Running \"" << this->path << "\" ..." << endl;
 
+    //The symbols are loaded while the process starts:
+    startSymbolTableLoading();
+
+    //Prepare the arguments before forking.
+    //The loader thread may hold the allocator lock, so the child must not allocate anymore.
+    //Pass the binary name as first parameter and the remaining args as other parameters.
+    args[0] = this->name;
+    vector<char*> cArgs;
+
+    for (vector<string>::iterator it = args.begin(); it != args.end(); ++it)
+    {
+        char* newArg = new char[it->size() + 1];
+
+        if (!newArg)
+        {
+            throw runtime_error("Failed to allocate argument string.");
+        }
+
+        strcpy(newArg, it->c_str());
+        cArgs.push_back(newArg);
+    }
+
+    //exec*() wants a NULL at the end:
+    cArgs.push_back(NULL);
+
     //Fork the process:
     this->pid = fork();
 
+    //Parent: Release the arguments again (without the trailing NULL):
+    if (this->pid != 0)
+    {
+        for (vector<char*>::iterator it = cArgs.begin(); it != cArgs.end() - 1; ++it)
+        {
+            delete[] *it;
+        }
+    }
+
     //Error:
     if (this->pid == -1)
     {
@@ -61,31 +149,10 @@ void Tracee::run(vector<string>& args)
         {
             //ptrace failed. We kill the child process.
             cerr << "Failed to mark the child process as traceable." << endl;
-            exit(-1);
-        }
-
-        //Replace the child process image with the destination process.
-        //Pass the binary name as first parameter and the remaining args as other parameters.
-        args[0] = this->name;
-        vector<char*> cArgs;
-
-        for (vector<string>::iterator it = args.begin(); it != args.end(); ++it)
-        {
-            //This memory will be released by the system if exec*() succeeds:
-            char* newArg = new char[it->size() + 1];
-
-            if (!newArg)
-            {
-                cerr << "Failed to allocate argument string." << endl;
-                exit(-1);
-            }
-
-            strcpy(newArg, it->c_str());
-            cArgs.push_back(newArg);
+            _exit(-1);
         }
 
-        //exec*() wants a NULL at the end:
-        cArgs.push_back(NULL);
+        //Replace the child process image with the destination process:
         execvp(this->path.c_str(), &cArgs[0]);
 
         //exec*() only returns on error:
@@ -100,14 +167,8 @@ void Tracee::run(vector<string>& args)
         default: cerr << "Failed to execute the selected binary (execvp error code: " << strerror(errno) << ")." << endl;
         }
 
-        //Release the allocated arguments (without the trailing NULL):
-        for (vector<char*>::iterator it = cArgs.begin(); it != cArgs.end() - 1; ++it)
-        {
-            delete *it;
-        }
-
-        //Kill the child process:
-        exit(-1);
+        //Kill the child process (without running the exit handlers of the debugger):
+        _exit(-1);
     }
 }
 
@@ -152,6 +213,9 @@ void Tracee::attach(vector<string>& args)
     //Try to assign name and path:
     assignNameAndPath(path);
 
+    //The symbols are loaded while the process stops:
+    startSymbolTableLoading();
+
     //Attach to the given PID:
     if (ptrace(PTRACE_ATTACH, this->pid, NULL, 0))
     {
@@ -168,12 +232,37 @@ void Tracee::attach(vector<string>& args)
 }
 
 
+void Tracee::openStatic(vector<string>& args)
+{
+    //Read the arguments:
+    if (args.size() < 1)
+    {
+        throw runtime_error("No path for static mode provided.");
+    }
+
+    //Try to assign name and path:
+    assignNameAndPath(args[0]);
+    cout << "Mapping \"" << this->path << "\" ..." << endl;
+
+    //The symbols are loaded while the binary is mapped:
+    startSymbolTableLoading();
+
+    //Map the binary:
+    this->image = new ElfImage(this->path);
+
+    //There is no process, so the instruction pointer starts at the entry point:
+    this->registers.REG_IP = this->image->getEntry();
+}
+
+
 Tracee::Tracee(vector<string>& args)
-    : pid(-1), creationMode(""), name(""), path(""), symbolTable(NULL)
+    : pid(-1), creationMode(""), name(""), path(""), symbolTable(NULL), loadBias(0), loadBiasValid(false), sharedObjects(NULL), image(NULL), memoryFile(-1), memoryFileWritable(false), vmReadAvailable(true), memoryMapChecked(false)
 {
     //Null the structs:
     memset(&this->registers, 0, sizeof(this->registers));
 
+    this->sharedObjects = new SharedObjects(*this);
+
     //There must be at least one argument to specify the method:
     if (args.size() < 1)
     {
@@ -194,31 +283,190 @@ Tracee::Tracee(vector<string>& args)
     {
         attach(args);
     }
+    //Static:
+    else if (this->creationMode == "static")
+    {
+        openStatic(args);
+    }
     else
     {
         throw runtime_error("Unknown tracee creation method: " + this->creationMode + ".");
     }
-
-    //Load the symbol table:
-    cout << "Loading symbol table ..." << endl;
-    this->symbolTable = new SymbolTable(this->path);
 }
 
 
 Tracee::~Tracee()
 {
-    //Free the symbol table:
+    //Close the memory file:
+    if (this->memoryFile >= 0)
+    {
+        close(this->memoryFile);
+        this->memoryFile = -1;
+    }
+
+    //Free the shared objects:
+    delete this->sharedObjects;
+    this->sharedObjects = NULL;
+
+    //Free the symbol table (it may still be loading):
+    if (!this->symbolTable && this->symbolTableLoader.valid())
+    {
+        try
+        {
+            this->symbolTable = this->symbolTableLoader.get();
+        }
+        catch (...)
+        {
+            //Nothing to free.
+        }
+    }
+
     if (this->symbolTable)
     {
         delete this->symbolTable;
         this->symbolTable = NULL;
     }
+
+    //Unmap the binary:
+    if (this->image)
+    {
+        delete this->image;
+        this->image = NULL;
+    }
+}
+
+
+word Tracee::computeLoadBias()
+{
+    ElfImage binary(this->path);
+
+    //The kernel passes the runtime entry point:
+    word entry = 0;
+
+    if (getAuxiliaryValue(AT_ENTRY, entry))
+    {
+        return entry - binary.getEntry();
+    }
+
+    //Otherwise the first mapping of the binary tells (it maps the page of the first segment):
+    if (binary.getSegments().empty())
+    {
+        return 0;
+    }
+
+    const vector<MemoryRegion>& regions = this->memoryMap.getRegions();
+
+    for (vector<MemoryRegion>::const_iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        if ((it->offset == 0) && (it->path == this->path))
+        {
+            return it->start - (binary.getSegments()[0].address & ~((word)PAGE_SIZE_BYTES - 1));
+        }
+    }
+
+    return 0;
+}
+
+
+word Tracee::getLoadBias()
+{
+    //The mapped binary is at its link time addresses:
+    if (isStatic() || (this->pid <= 0))
+    {
+        return 0;
+    }
+
+    if (!this->loadBiasValid)
+    {
+        try
+        {
+            this->loadBias = computeLoadBias();
+        }
+        catch (const runtime_error& err)
+        {
+            this->loadBias = 0;
+        }
+
+        this->loadBiasValid = true;
+    }
+
+    return this->loadBias;
+}
+
+
+bool Tracee::findSymbol(const string& name, word& address)
+{
+    //The binary comes first:
+    const Symbol* symbol = getSymbolTable()->find(name);
+
+    if (symbol)
+    {
+        address = symbol->address + getLoadBias();
+        return true;
+    }
+
+    return this->sharedObjects->findSymbol(name, address);
+}
+
+
+bool Tracee::lookupSymbol(word address, const char*& name, word& offset)
+{
+    return getSymbolTable()->lookup(address - getLoadBias(), name, offset) || this->sharedObjects->lookup(address, name, offset);
+}
+
+
+string Tracee::describeAddress(word address)
+{
+    const char* name = NULL;
+    word offset = 0;
+
+    if (!lookupSymbol(address, name, offset))
+    {
+        return "";
+    }
+
+    stringstream result;
+    result << name;
+
+    if (offset != 0)
+    {
+        result << "+0x" << hex << offset;
+    }
+
+    return result.str();
+}
+
+
+bool Tracee::getAuxiliaryValue(word type, word& value) const
+{
+    ifstream auxv("/proc/" + to_string(this->pid) + "/auxv", ios::binary);
+    word entry[2];
+
+    //It's a list of (type, value) pairs terminated by AT_NULL:
+    while (auxv.read((char*)entry, sizeof(entry)) && (entry[0] != AT_NULL))
+    {
+        if (entry[0] == type)
+        {
+            value = entry[1];
+            return true;
+        }
+    }
+
+    return false;
 }
 
 
 ostream& operator<<(ostream& os, Tracee& tracee)
 {
-    return os << "File path: \"" << tracee.path << "\", PID: " << tracee.pid << ", Creation mode: " << tracee.creationMode << ", Symbol table: " << tracee.symbolTable->getMap().size() << " symbols loaded.";
+    os << "File path: \"" << tracee.path << "\", PID: " << tracee.pid << ", Creation mode: " << tracee.creationMode << ", Symbol table: ";
+
+    //Don't wait for the symbols just for printing:
+    if (!tracee.isSymbolTableLoaded())
+    {
+        return os << "loading in the background.";
+    }
+
+    return os << tracee.getSymbolTable()->size() << " symbols loaded" << (tracee.getSymbolTable()->isCached() ? " from the cache." : ".");
 }
 
 
@@ -237,6 +485,9 @@ void Tracee::initialize()
         default: throw runtime_error(string("Failed to set debug options (ptrace error code: ") + strerror(errno) + ").");
         }
     }
+
+    //Follow the address space from now on:
+    this->memoryMap.setPID(this->pid);
 }
 
 
@@ -262,6 +513,9 @@ void Tracee::setRegisters(struct user_regs_struct& registers)
 
 void Tracee::continueProcess(int signal)
 {
+    //The process will change its memory:
+    invalidateMemoryCache();
+
     if (ptrace(PTRACE_SYSCALL, this->pid, NULL, signal))
     {
         throw runtime_error(string("Failed to execute PTRACE_SYSCALL (ptrace error code: ") + strerror(errno) + ").");
@@ -271,6 +525,9 @@ void Tracee::continueProcess(int signal)
 
 void Tracee::detachFromProcess(int signal)
 {
+    //The process runs on its own afterwards:
+    invalidateMemoryCache();
+
     if (ptrace(PTRACE_DETACH, this->pid, NULL, signal))
     {
         throw runtime_error(string("Failed to execute PTRACE_DETACH (ptrace error code: ") + strerror(errno) + ").");
@@ -280,6 +537,9 @@ void Tracee::detachFromProcess(int signal)
 
 void Tracee::killProcess()
 {
+    //The process is gone afterwards:
+    invalidateMemoryCache();
+
     if (kill(this->pid, SIGKILL))
     {
         throw runtime_error(string("Failed to kill debugged process (kill error code: ") + strerror(errno) + ").");
@@ -289,6 +549,9 @@ void Tracee::killProcess()
 
 void Tracee::performStep()
 {
+    //The process will change its memory:
+    invalidateMemoryCache();
+
     if (ptrace(PTRACE_SINGLESTEP, this->pid, NULL, 0))
     {
         throw runtime_error(string("Failed to execute PTRACE_SINGLESTEP (ptrace error code: ") + strerror(errno) + ").");
@@ -296,88 +559,729 @@ void Tracee::performStep()
 }
 
 
-word Tracee::peekWord(pword address)
+bool Tracee::performBlockStep()
 {
-    //Execute the ptrace:
-    word result = ptrace(PTRACE_PEEKDATA, this->pid, address, 0);
+    //The process will change its memory:
+    invalidateMemoryCache();
 
-    if (errno)
+    if (ptrace(PTRACE_SINGLEBLOCK, this->pid, NULL, 0))
     {
-        throw runtime_error(string("Failed to execute PTRACE_PEEKDATA (ptrace error code: ") + strerror(errno) + ").");
+        //Not supported by this kernel resp. arch:
+        if (errno == EIO)
+        {
+            return false;
+        }
+
+        throw runtime_error(string("Failed to execute PTRACE_SINGLEBLOCK (ptrace error code: ") + strerror(errno) + ").");
     }
 
-    return result;
+    return true;
 }
 
 
-void Tracee::peekToPtr(pword address, int count, byte* ptr)
+//The sequence block stepped by the probe: plain instructions, a taken branch and a trap at its target.
+//With the branch trap flag the step stops at the target, without it right behind the first instruction:
+asm(".pushsection .text\n"
+    "ldbBlockStepProbe:\n"
+    "    nop\n"
+    "    nop\n"
+    "    jmp ldbBlockStepProbeTarget\n"
+    "    nop\n"
+    "ldbBlockStepProbeTarget:\n"
+    "    int3\n"
+    ".popsection\n");
+
+extern "C" char ldbBlockStepProbe[] __attribute__((visibility("hidden")));
+extern "C" char ldbBlockStepProbeTarget[] __attribute__((visibility("hidden")));
+
+bool Tracee::probeBlockStepping()
+{
+    pid_t child = fork();
+
+    if (child == -1)
+    {
+        return false;
+    }
+
+    //Child: Only async-signal-safe calls, the debugger may run other threads.
+    //The code is the same in the child, so the parent moves its IP to the sequence:
+    if (child == 0)
+    {
+        if (ptrace(PTRACE_TRACEME, 0, NULL, 0) == 0)
+        {
+            raise(SIGSTOP);
+        }
+
+        _exit(0);
+    }
+
+    bool works = false;
+    int status;
+
+    if ((waitpid(child, &status, 0) == child) && WIFSTOPPED(status))
+    {
+        struct user_regs_struct registers;
+
+        if (ptrace(PTRACE_GETREGS, child, NULL, &registers) == 0)
+        {
+            registers.REG_IP = (word)ldbBlockStepProbe;
+
+            //Any failure (like EIO if the kernel does not support block steps) counts as not working:
+            if ((ptrace(PTRACE_SETREGS, child, NULL, &registers) == 0) &&
+                (ptrace(PTRACE_SINGLEBLOCK, child, NULL, 0) == 0) &&
+                (waitpid(child, &status, 0) == child) && WIFSTOPPED(status) && (WSTOPSIG(status) == SIGTRAP) &&
+                (ptrace(PTRACE_GETREGS, child, NULL, &registers) == 0))
+            {
+                works = (registers.REG_IP == (word)ldbBlockStepProbeTarget);
+            }
+        }
+    }
+
+    //Reap it, so the debug loop never sees it:
+    kill(child, SIGKILL);
+    waitpid(child, &status, 0);
+
+    return works;
+}
+
+
+//Transfer memory with process_vm_readv resp. process_vm_writev.
+//The remote range is split at page boundaries. A partial transfer never splits an iovec, so this stops exactly at the first inaccessible page.
+//This returns the number of bytes transferred and sets error to the errno of a failed call (0 otherwise):
+static int transferMemoryVm(pid_t pid, word address, int count, byte* ptr, bool write, int& error)
+{
+    int total = 0;
+    error = 0;
+
+    while (total < count)
+    {
+        struct iovec remote[IOV_MAX];
+        int remoteCount = 0;
+        int batchBytes = 0;
+        word current = address + total;
+
+        while (((total + batchBytes) < count) && (remoteCount < IOV_MAX))
+        {
+            int length = min(count - total - batchBytes, PAGE_SIZE_BYTES - (int)(current % PAGE_SIZE_BYTES));
+
+            remote[remoteCount].iov_base = (void*)current;
+            remote[remoteCount].iov_len = length;
+            remoteCount++;
+
+            current += length;
+            batchBytes += length;
+        }
+
+        //The local side is one contiguous buffer:
+        struct iovec local;
+        local.iov_base = ptr + total;
+        local.iov_len = batchBytes;
+
+        ssize_t result = write ? process_vm_writev(pid, &local, 1, remote, remoteCount, 0) : process_vm_readv(pid, &local, 1, remote, remoteCount, 0);
+
+        if (result < 0)
+        {
+            error = errno;
+            break;
+        }
+
+        total += result;
+
+        //A partial transfer means we have hit an inaccessible page:
+        if (result < batchBytes)
+        {
+            break;
+        }
+    }
+
+    return total;
+}
+
+
+int Tracee::readMemoryVm(pword address, int count, byte* ptr)
+{
+    //Did process_vm_readv fail for good before?
+    if (!this->vmReadAvailable)
+    {
+        return 0;
+    }
+
+    int error = 0;
+    int total = transferMemoryVm(this->pid, (word)address, count, ptr, false, error);
+
+    //Don't try again if the syscall is not usable at all (old kernel, missing permission):
+    if ((error == ENOSYS) || (error == EPERM))
+    {
+        this->vmReadAvailable = false;
+    }
+
+    return total;
+}
+
+
+bool Tracee::openMemoryFile()
+{
+    //Concurrent readers may get here at the same time:
+    call_once(this->memoryFileOpened, [this]()
+    {
+        //Writing may not be allowed, reading is enough then:
+        string memoryPath = "/proc/" + to_string(this->pid) + "/mem";
+        this->memoryFile = open(memoryPath.c_str(), O_RDWR | O_CLOEXEC);
+        this->memoryFileWritable = (this->memoryFile >= 0);
+
+        if (this->memoryFile < 0)
+        {
+            this->memoryFile = open(memoryPath.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+
+        if (this->memoryFile < 0)
+        {
+            this->memoryFile = -2;
+        }
+    });
+
+    return this->memoryFile >= 0;
+}
+
+
+int Tracee::readMemoryFile(pword address, int count, byte* ptr)
 {
-    //Peek the aligned part:
-    for (int i = 0; i < (count / WORD_SIZE_BYTES); i++)
+    //Not available:
+    if (!openMemoryFile())
     {
-        //Peek the word and increment the pointer and address:
-        *((pword)ptr) = peekWord(address++);
-        ptr += WORD_SIZE_BYTES;
+        return 0;
     }
 
-    //Peek the dead bytes:
-    int deadBytes = count % WORD_SIZE_BYTES;
+    int total = 0;
 
-    if (deadBytes > 0)
+    while (total < count)
     {
-        //Peek the word:
-        word lastWord = peekWord(address);
+        //The file offset is the address (pread stops short at an unreadable page):
+        ssize_t result = pread64(this->memoryFile, ptr + total, count - total, (off64_t)((word)address + total));
 
-        //Write the important part:
-        for (int i = 0; i < deadBytes; i++)
+        if (result <= 0)
         {
-            ptr[i] = lastWord & ((word)0xFF << (8 * i));
+            break;
         }
+
+        total += result;
+    }
+
+    return total;
+}
+
+
+int Tracee::readMemoryPtrace(pword address, int count, byte* ptr)
+{
+    int total = 0;
+
+    while (total < count)
+    {
+        //Peek the next (maybe unaligned) word:
+        errno = 0;
+        word result = ptrace(PTRACE_PEEKDATA, this->pid, ((pbyte)address) + total, 0);
+
+        if (errno)
+        {
+            break;
+        }
+
+        //Copy only the requested part:
+        int length = min(WORD_SIZE_BYTES, count - total);
+        memcpy(ptr + total, &result, length);
+
+        total += length;
+    }
+
+    return total;
+}
+
+
+int Tracee::readMemoryUncached(pword address, int count, byte* ptr)
+{
+    //Don't bother the backends with unmapped memory:
+    word mappedCount = this->memoryMap.getMappedLength((word)address, count);
+
+    if ((mappedCount < (word)count) && !this->memoryMapChecked)
+    {
+        this->memoryMap.invalidate();
+        this->memoryMapChecked = true;
+
+        mappedCount = this->memoryMap.getMappedLength((word)address, count);
+    }
+
+    count = mappedCount;
+    int total = 0;
+
+    while (total < count)
+    {
+        pword current = (pword)(((pbyte)address) + total);
+
+        //Try the backends from the fastest to the slowest one.
+        //Each backend continues where the previous one has stopped:
+        int result = readMemoryVm(current, count - total, ptr + total);
+
+        if (result == 0)
+        {
+            result = readMemoryFile(current, count - total, ptr + total);
+        }
+
+        if (result == 0)
+        {
+            result = readMemoryPtrace(current, count - total, ptr + total);
+        }
+
+        //Nothing readable at this address:
+        if (result == 0)
+        {
+            break;
+        }
+
+        total += result;
+    }
+
+    return total;
+}
+
+
+int Tracee::readMemoryDirect(pword address, int count, byte* ptr)
+{
+    //The mapped binary is never changed:
+    if (this->image)
+    {
+        return this->image->read((word)address, count, ptr);
+    }
+
+    int total = 0;
+
+    if (this->vmReadAvailable)
+    {
+        int error = 0;
+        total = transferMemoryVm(this->pid, (word)address, count, ptr, false, error);
+    }
+
+    //The file can read what process_vm_readv can't (like pages without read permission):
+    if ((total < count) && openMemoryFile())
+    {
+        while (total < count)
+        {
+            ssize_t result = pread64(this->memoryFile, ptr + total, count - total, (off64_t)((word)address + total));
+
+            if (result <= 0)
+            {
+                break;
+            }
+
+            total += result;
+        }
+    }
+
+    return total;
+}
+
+
+void Tracee::updateMemoryCache(pword address, int count, const byte* ptr)
+{
+    int total = 0;
+
+    while (total < count)
+    {
+        //Find the page of the current byte:
+        word current = ((word)address) + total;
+        word page = current & ~((word)PAGE_SIZE_BYTES - 1);
+        int offset = current - page;
+        int length = min(count - total, PAGE_SIZE_BYTES - offset);
+
+        //Only patch pages that are cached:
+        map<word, vector<byte> >::iterator it = this->memoryCache.find(page);
+
+        if (it != this->memoryCache.end())
+        {
+            memcpy(&it->second[offset], ptr + total, length);
+        }
+
+        total += length;
+    }
+}
+
+
+void Tracee::invalidateMemoryCache()
+{
+    this->memoryCache.clear();
+    this->memoryMapChecked = false;
+}
+
+
+void Tracee::invalidateDecodeCache(pword address, int count)
+{
+    //Every instruction starting up to MAX_INSTRUCTION_BYTES - 1 bytes before the range may overlap it:
+    word first = (word)address;
+    word last = first + count;
+    first = (first >= (word)(MAX_INSTRUCTION_BYTES - 1)) ? (first - (MAX_INSTRUCTION_BYTES - 1)) : 0;
+
+    //Erase the range (the keys are ordered by address first):
+    this->decodeCache.erase(this->decodeCache.lower_bound(make_pair(first, false)), this->decodeCache.lower_bound(make_pair(last, false)));
+}
+
+
+void Tracee::invalidateDecodeCache()
+{
+    this->decodeCache.clear();
+}
+
+
+int Tracee::readMemory(pword address, int count, byte* ptr)
+{
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    //Static mode reads straight from the mapped binary:
+    if (this->image)
+    {
+        return this->image->read((word)address, count, ptr);
+    }
+
+    //Get the range of pages:
+    word start = (word)address;
+    word firstPage = start & ~((word)PAGE_SIZE_BYTES - 1);
+    word lastPage = (start + count - 1) & ~((word)PAGE_SIZE_BYTES - 1);
+
+    //Large reads go directly to the process:
+    if (((lastPage - firstPage) / PAGE_SIZE_BYTES) >= MEMORY_CACHE_MAX_READ_PAGES)
+    {
+        return readMemoryUncached(address, count, ptr);
+    }
+
+    //Find the span of pages not cached yet:
+    bool missing = false;
+    word firstMissing = 0;
+    word lastMissing = 0;
+
+    for (word page = firstPage; page <= lastPage; page += PAGE_SIZE_BYTES)
+    {
+        if (this->memoryCache.find(page) == this->memoryCache.end())
+        {
+            if (!missing)
+            {
+                firstMissing = page;
+                missing = true;
+            }
+
+            lastMissing = page;
+        }
+    }
+
+    //Fill them with one bulk read:
+    if (missing)
+    {
+        int spanBytes = (lastMissing - firstMissing) + PAGE_SIZE_BYTES;
+        vector<byte> span(spanBytes);
+        int readBytes = readMemoryUncached((pword)firstMissing, spanBytes, &span[0]);
+
+        //Cache all the complete pages:
+        for (int offset = 0; (offset + PAGE_SIZE_BYTES) <= readBytes; offset += PAGE_SIZE_BYTES)
+        {
+            word page = firstMissing + offset;
+
+            if (this->memoryCache.find(page) == this->memoryCache.end())
+            {
+                this->memoryCache[page].assign(span.begin() + offset, span.begin() + offset + PAGE_SIZE_BYTES);
+            }
+        }
+    }
+
+    //Copy from the cache:
+    int total = 0;
+
+    while (total < count)
+    {
+        word current = start + total;
+        word page = current & ~((word)PAGE_SIZE_BYTES - 1);
+
+        map<word, vector<byte> >::iterator it = this->memoryCache.find(page);
+
+        if (it == this->memoryCache.end())
+        {
+            break;
+        }
+
+        int offset = current - page;
+        int length = min(count - total, PAGE_SIZE_BYTES - offset);
+        memcpy(ptr + total, &it->second[offset], length);
+
+        total += length;
+    }
+
+    //A page that was not completely readable may still hold some of the requested bytes:
+    if (total < count)
+    {
+        total += readMemoryUncached((pword)(start + total), count - total, ptr + total);
+    }
+
+    return total;
+}
+
+
+word Tracee::peekWord(pword address)
+{
+    //Read it through the memory cache:
+    word result = 0;
+    peekToPtr(address, WORD_SIZE_BYTES, (pbyte)&result);
+
+    return result;
+}
+
+
+void Tracee::peekToPtr(pword address, int count, byte* ptr)
+{
+    //Read in bulk:
+    int result = readMemory(address, count, ptr);
+
+    //Everything must be readable:
+    if (result < count)
+    {
+        ostringstream message;
+        message << "Failed to read tracee memory at 0x" << hex << (((word)address) + result) << ".";
+
+        throw runtime_error(message.str());
     }
 }
 
 
 void Tracee::pokeWord(pword address, word content)
 {
+    //The mapped binary is read-only:
+    if (this->image)
+    {
+        throw runtime_error("Writing memory needs a running process.");
+    }
+
     //Execute the ptrace:
     if (ptrace(PTRACE_POKEDATA, this->pid, address, content))
     {
         throw runtime_error(string("Failed to execute PTRACE_POKEDATA (ptrace error code: ") + strerror(errno) + ").");
     }
+
+    //Keep the caches up to date:
+    updateMemoryCache(address, WORD_SIZE_BYTES, (pbyte)&content);
+    invalidateDecodeCache(address, WORD_SIZE_BYTES);
 }
 
 
-Mnemonic Tracee::disassemble(pword address, bool att)
+int Tracee::writeMemoryVm(pword address, int count, const byte* ptr)
 {
-    //Prepare a buffer:
-    word buffer[MAX_INSTRUCTION_WORDS];
+    //Did process_vm_readv fail for good before (the writing counterpart has the same requirements)?
+    if (!this->vmReadAvailable)
+    {
+        return 0;
+    }
+
+    //This fails for read-only pages (like code), the other backends can write them:
+    int error = 0;
+    return transferMemoryVm(this->pid, (word)address, count, (byte*)ptr, true, error);
+}
 
-    //Read the words:
-    for (int i = 0; i < MAX_INSTRUCTION_WORDS; i++)
+
+int Tracee::writeMemoryFile(pword address, int count, const byte* ptr)
+{
+    if (!openMemoryFile() || !this->memoryFileWritable)
+    {
+        return 0;
+    }
+
+    int total = 0;
+
+    while (total < count)
     {
-        buffer[i] = peekWord(address + i);
+        ssize_t result = pwrite64(this->memoryFile, ptr + total, count - total, (off64_t)((word)address + total));
+
+        if (result <= 0)
+        {
+            break;
+        }
+
+        total += result;
     }
 
-    //Create and return mnemonic:
-    return Mnemonic(buffer, att);
+    return total;
 }
 
 
-vector<Mnemonic> Tracee::disassemble(pword address, bool att, int count, int& bytesCount)
+int Tracee::writeMemoryPtrace(pword address, int count, const byte* ptr)
+{
+    int total = 0;
+
+    while (total < count)
+    {
+        //Merge partial words with the current content:
+        pbyte current = ((pbyte)address) + total;
+        int length = min(WORD_SIZE_BYTES, count - total);
+        word content = 0;
+
+        if (length < WORD_SIZE_BYTES)
+        {
+            errno = 0;
+            content = ptrace(PTRACE_PEEKDATA, this->pid, current, 0);
+
+            if (errno)
+            {
+                break;
+            }
+        }
+
+        memcpy(&content, ptr + total, length);
+
+        if (ptrace(PTRACE_POKEDATA, this->pid, current, content))
+        {
+            break;
+        }
+
+        total += length;
+    }
+
+    return total;
+}
+
+
+int Tracee::writeMemory(pword address, int count, const byte* ptr)
+{
+    //The mapped binary is read-only:
+    if (this->image)
+    {
+        throw runtime_error("Writing memory needs a running process.");
+    }
+
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    int total = 0;
+
+    while (total < count)
+    {
+        pword current = (pword)(((pbyte)address) + total);
+
+        //Try the backends from the fastest to the slowest one.
+        //Each backend continues where the previous one has stopped:
+        int result = writeMemoryVm(current, count - total, ptr + total);
+
+        if (result == 0)
+        {
+            result = writeMemoryFile(current, count - total, ptr + total);
+        }
+
+        if (result == 0)
+        {
+            result = writeMemoryPtrace(current, count - total, ptr + total);
+        }
+
+        //Nothing writable at this address:
+        if (result == 0)
+        {
+            break;
+        }
+
+        total += result;
+    }
+
+    //Keep the caches up to date:
+    updateMemoryCache(address, total, ptr);
+    invalidateDecodeCache(address, total);
+
+    return total;
+}
+
+
+void Tracee::cacheMnemonic(pword address, bool att, const Mnemonic& mnemonic)
+{
+    //Start over if the cache has grown too large:
+    if (this->decodeCache.size() >= DECODE_CACHE_MAX_ENTRIES)
+    {
+        this->decodeCache.clear();
+    }
+
+    this->decodeCache.insert(make_pair(make_pair((word)address, att), mnemonic));
+}
+
+
+vector<Mnemonic> Tracee::decodeRange(pword address, bool att, int count, int& bytesCount, bool withText)
 {
     //Collect mnemonics:
     vector<Mnemonic> mnemonics;
     bytesCount = 0;
 
+    //The window of bytes read from the process.
+    //It is followed by zero padding, so an instruction at the end of a readable region is padded like a single one:
+    vector<byte> window;
+    word windowStart = 0;
+    int windowLength = 0;
+    bool windowTruncated = false;
+
     for (int i = 0; i < count; i++)
     {
-        //Disassemble one instruction:
-        Mnemonic mnemonic = disassemble(address, att);
-        mnemonics.push_back(mnemonic);
+        //Decoded before?
+        if (withText)
+        {
+            map<pair<word, bool>, Mnemonic>::iterator it = this->decodeCache.find(make_pair((word)address, att));
+
+            if (it != this->decodeCache.end())
+            {
+                mnemonics.push_back(it->second);
+
+                //Increment address and total count:
+                address = (pword)(((pbyte)address) + it->second.getOpcodeLength());
+                bytesCount += it->second.getOpcodeLength();
+
+                continue;
+            }
+        }
+
+        //Does the window cover the whole instruction (or does the readable memory end within it)?
+        word windowEnd = windowStart + windowLength;
+        bool covered = ((word)address >= windowStart) && ((((word)address + MAX_INSTRUCTION_BYTES) <= windowEnd) || (windowTruncated && ((word)address < windowEnd)));
+
+        if (!covered)
+        {
+            //Read enough bytes for the remaining instructions, but end the window at a page boundary:
+            int wanted = min((count - i) * MAX_INSTRUCTION_BYTES, DISASSEMBLY_WINDOW_MAX_BYTES);
+            word end = ((word)address + wanted + PAGE_SIZE_BYTES - 1) & ~((word)PAGE_SIZE_BYTES - 1);
+            int requested = end - (word)address;
+
+            window.assign(requested + MAX_INSTRUCTION_BYTES, 0);
+            windowStart = (word)address;
+            windowLength = readMemory(address, requested, &window[0]);
+            windowTruncated = (windowLength < requested);
+
+            if (windowLength == 0)
+            {
+                ostringstream message;
+                message << "Failed to read instruction at 0x" << hex << (word)address << ".";
+
+                throw runtime_error(message.str());
+            }
+        }
+
+        //Decode out of the window:
+        const byte* buffer = &window[(word)address - windowStart];
+
+        if (withText)
+        {
+            Mnemonic mnemonic = this->disassembler.decode(buffer, MAX_INSTRUCTION_BYTES, att);
+            cacheMnemonic(address, att, mnemonic);
+            mnemonics.push_back(mnemonic);
+        }
+        else
+        {
+            int opcodeLength = this->disassembler.decodeLength(buffer, MAX_INSTRUCTION_BYTES);
+            mnemonics.push_back(Mnemonic(buffer, opcodeLength, "", 0));
+        }
 
         //Increment address and total count:
-        address = (pword)(((pbyte)address) + mnemonic.getOpcodeLength());
-        bytesCount += mnemonic.getOpcodeLength();
+        address = (pword)(((pbyte)address) + mnemonics.back().getOpcodeLength());
+        bytesCount += mnemonics.back().getOpcodeLength();
     }
 
     //Return the mnemonics:
@@ -385,6 +1289,49 @@ vector<Mnemonic> Tracee::disassemble(pword address, bool att, int count, int& by
 }
 
 
+Mnemonic Tracee::disassemble(pword address, bool att)
+{
+    //Decoded before?
+    map<pair<word, bool>, Mnemonic>::iterator it = this->decodeCache.find(make_pair((word)address, att));
+
+    if (it != this->decodeCache.end())
+    {
+        return it->second;
+    }
+
+    //Prepare a buffer (zero padded, the instruction may be located at the end of a readable region):
+    word buffer[MAX_INSTRUCTION_WORDS];
+    memset(buffer, 0, sizeof(buffer));
+
+    //Read the bytes:
+    if (readMemory(address, MAX_INSTRUCTION_BYTES, (pbyte)buffer) == 0)
+    {
+        ostringstream message;
+        message << "Failed to read instruction at 0x" << hex << (word)address << ".";
+
+        throw runtime_error(message.str());
+    }
+
+    //Decode and cache the mnemonic:
+    Mnemonic mnemonic = this->disassembler.decode((pbyte)buffer, MAX_INSTRUCTION_BYTES, att);
+    cacheMnemonic(address, att, mnemonic);
+
+    return mnemonic;
+}
+
+
+vector<Mnemonic> Tracee::disassemble(pword address, bool att, int count, int& bytesCount)
+{
+    return decodeRange(address, att, count, bytesCount, true);
+}
+
+
+vector<Mnemonic> Tracee::decodeOpcodes(pword address, int count, int& bytesCount)
+{
+    return decodeRange(address, false, count, bytesCount, false);
+}
+
+
 Mnemonic Tracee::disassemble(bool att)
 {
     return disassemble((pword)this->registers.REG_IP, att);
@@ -1,18 +1,34 @@
 #ifndef TRACEE_H
 #define TRACEE_H
 
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <sys/user.h>
 #include <unistd.h>
 #include <vector>
 
+#include "Disassembler.hpp"
+#include "ElfImage.hpp"
 #include "Globals.hpp"
+#include "MemoryMap.hpp"
 #include "Mnemonic.hpp"
+#include "SharedObjects.hpp"
 #include "SymbolTable.hpp"
 
 #define offset_of(tp, member) (((char*)&((tp*)0)->member) - (char*)0)
 
+//Reads spanning more pages than this bypass the memory cache:
+#define MEMORY_CACHE_MAX_READ_PAGES 16
+
+//The decode cache is dropped completely once it holds that many instructions:
+#define DECODE_CACHE_MAX_ENTRIES 65536
+
+//Batch disassembly reads at most that many bytes at once:
+#define DISASSEMBLY_WINDOW_MAX_BYTES (16 * PAGE_SIZE_BYTES)
+
 using namespace std;
 
 class Tracee
@@ -32,12 +48,55 @@ private:
     //The path to the binary (including the file name at the end):
     string path;
 
-    //The symbol table of the binary:
+    //The symbol table of the binary (NULL while it is loaded in the background):
     SymbolTable* symbolTable;
 
+    //The background loading of the symbol table:
+    future<SymbolTable*> symbolTableLoader;
+
+    //The load bias of the binary (runtime address = link time address + bias, non-zero for PIE).
+    //It's cached until the mappings change:
+    word loadBias;
+    bool loadBiasValid;
+
+    //The shared objects loaded into the process:
+    SharedObjects* sharedObjects;
+
+    //The mapped binary in static mode (NULL if there is a process):
+    ElfImage* image;
+
     //The current registers:
     struct user_regs_struct registers;
 
+    //The disassembler context (reused for every instruction):
+    Disassembler disassembler;
+
+    //Bulk memory access.
+    //The file descriptor of /proc/<pid>/mem (-1 if not opened yet, -2 if not available):
+    int memoryFile;
+
+    //Was it opened for writing as well?
+    bool memoryFileWritable;
+
+    //It's opened only once, even by concurrent readers:
+    once_flag memoryFileOpened;
+
+    //Is process_vm_readv usable for this process?
+    bool vmReadAvailable;
+
+    //The mapped regions (they let reads skip unmapped memory).
+    //It may be outdated if mapping changes were not traced, so a miss is checked against a fresh one once per stop:
+    MemoryMap memoryMap;
+    bool memoryMapChecked;
+
+    //The memory cache of the current stop (page address -> page content).
+    //It only holds completely readable pages and is invalidated whenever the process resumes:
+    map<word, vector<byte> > memoryCache;
+
+    //The decode cache ((address, AT&T flavor) -> decoded instruction).
+    //Unlike the memory cache it survives resumes and is only invalidated by writes and mapping changes:
+    map<pair<word, bool>, Mnemonic> decodeCache;
+
     //Methods:
 private:
 
@@ -45,17 +104,87 @@ private:
     //This throws an exception if the path is invalid.
     void assignNameAndPath(string binaryPath);
 
+    //Start loading the symbol table in the background (called as soon as the path is known):
+    void startSymbolTableLoading();
+
+    //Determine the load bias from the auxiliary vector resp. the mappings:
+    word computeLoadBias();
+
     //Initialization methods called by the constructor:
     void run(vector<string>& args);
     void attach(vector<string>& args);
+    void openStatic(vector<string>& args);
+
+    //Bulk memory reading backends.
+    //All of them return the number of bytes read and stop at the first unreadable byte:
+    int readMemoryVm(pword address, int count, byte* ptr);
+    int readMemoryFile(pword address, int count, byte* ptr);
+    int readMemoryPtrace(pword address, int count, byte* ptr);
+
+    //Read memory with all the backends, bypassing the memory cache:
+    int readMemoryUncached(pword address, int count, byte* ptr);
+
+    //Open /proc/<pid>/mem on first use (false if it is not available):
+    bool openMemoryFile();
+
+    //Bulk memory writing backends.
+    //All of them return the number of bytes written and stop at the first unwritable byte:
+    int writeMemoryVm(pword address, int count, const byte* ptr);
+    int writeMemoryFile(pword address, int count, const byte* ptr);
+    int writeMemoryPtrace(pword address, int count, const byte* ptr);
+
+    //Update the cached pages after a write:
+    void updateMemoryCache(pword address, int count, const byte* ptr);
+
+    //Add a decoded instruction to the decode cache:
+    void cacheMnemonic(pword address, bool att, const Mnemonic& mnemonic);
+
+    //Decode some instructions out of one contiguous read, with or without their assembly text:
+    vector<Mnemonic> decodeRange(pword address, bool att, int count, int& bytesCount, bool withText);
 
 public:
 
     //Get the PID:
     inline pid_t getPID() const { return this->pid; }
 
-    //Get the symbol table:
-    inline SymbolTable* getSymbolTable() const { return this->symbolTable; }
+    //Get the path to the binary:
+    inline const string& getPath() const { return this->path; }
+
+    //Is this only a mapped binary without a process (static mode)?
+    inline bool isStatic() const { return this->image != NULL; }
+
+    //Get the mapped binary (static mode only):
+    inline const ElfImage* getImage() const { return this->image; }
+
+    //Get the symbol table (this waits for the background loading to finish):
+    SymbolTable* getSymbolTable();
+
+    //Has the symbol table been loaded?
+    bool isSymbolTableLoaded() const;
+
+    //Get the memory map:
+    inline MemoryMap& getMemoryMap() { return this->memoryMap; }
+
+    //Get the shared objects:
+    inline SharedObjects& getSharedObjects() { return *this->sharedObjects; }
+
+    //Get the load bias of the binary (0 in static mode and for non-PIE binaries):
+    word getLoadBias();
+
+    //Recompute the load bias on next use (called after mapping changes):
+    inline void invalidateLoadBias() { this->loadBiasValid = false; }
+
+    //Find a symbol of the binary or a shared object by name and get its runtime address:
+    bool findSymbol(const string& name, word& address);
+
+    //Find the symbol of the binary or a shared object containing an address:
+    bool lookupSymbol(word address, const char*& name, word& offset);
+
+    //Describe an address as "symbol+0xoffset" (empty if there is no symbol):
+    string describeAddress(word address);
+
+    //Get an entry of the auxiliary vector of the process (false if there is none):
+    bool getAuxiliaryValue(word type, word& value) const;
 
     //Get the registers:
     inline const user_regs_struct& getRegisters() const { return this->registers; }
@@ -90,21 +219,53 @@ public:
     //Do a single step (this will fire a SIGTRAP):
     void performStep();
 
+    //Run up to the next taken branch (this will fire a SIGTRAP there).
+    //Returns false if the kernel does not support it:
+    bool performBlockStep();
+
+    //Check if block steps stop on taken branches only.
+    //This block steps a known sequence in a forked child, so it does not touch the debugged process:
+    static bool probeBlockStepping();
+
+    //Drop the memory cache (called whenever the process resumes):
+    void invalidateMemoryCache();
+
+    //Drop the decoded instructions overlapping a written range resp. all of them (after mapping changes):
+    void invalidateDecodeCache(pword address, int count);
+    void invalidateDecodeCache();
+
     //Peek a word:
     word peekWord(pword address);
 
-    //Peek multiple bytes and write them to a ptr (count is in bytes):
+    //Read multiple bytes and write them to a ptr (count is in bytes).
+    //This returns the number of bytes read, which is less than count if an unreadable address has been hit:
+    int readMemory(pword address, int count, byte* ptr);
+
+    //Read memory without the caches and without ptrace (bulk backends only), so it may be called by several threads at once.
+    //The process must stay stopped and nothing else may use the tracee meanwhile:
+    int readMemoryDirect(pword address, int count, byte* ptr);
+
+    //Peek multiple bytes and write them to a ptr (count is in bytes).
+    //This throws an exception if not all of the bytes are readable:
     void peekToPtr(pword address, int count, byte* ptr);
 
     //Poke a word:
     void pokeWord(pword address, word content);
 
+    //Write multiple bytes from a ptr (count is in bytes), keeping the caches up to date.
+    //This returns the number of bytes written, which is less than count if an unwritable address has been hit:
+    int writeMemory(pword address, int count, const byte* ptr);
+
     //Disassemble a single instruction at a given address:
     Mnemonic disassemble(pword address, bool att);
 
     //Disassemble some instructions starting at a given address.
     vector<Mnemonic> disassemble(pword address, bool att, int count, int& bytesCount);
 
+    //Decode some instructions starting at a given address without formatting any assembly text.
+    //Only the opcode lengths and raw opcodes are filled in:
+    vector<Mnemonic> decodeOpcodes(pword address, int count, int& bytesCount);
+
     //Disassemble at the current (ip) address:
     Mnemonic disassemble(bool att);
     vector<Mnemonic> disassemble(bool att, int count, int& bytesCount);
@@ -1,13 +1,14 @@
 #include "Tracer.hpp"
 
-#include <fstream>
+#include <fcntl.h>
 #include <iomanip>
 #include <iostream>
 #include <stdexcept>
 #include <stdlib.h>
+#include <string.h>
 
 Tracer::Tracer()
-    : mode(TRACING_MODE_NONE), output(NULL)
+    : mode(TRACING_MODE_NONE), active(false), output(NULL), fileBuffer(NULL), binaryOutput(NULL), overflow(ASYNC_WRITER_OVERFLOW_BLOCK), reportedDropCount(0), recordRegisters(false), lastRegisters()
 {
 
 }
@@ -29,7 +30,23 @@ void Tracer::closeOutput()
         this->output = NULL;
     }
 
+    if (this->fileBuffer)
+    {
+        delete this->fileBuffer;
+        this->fileBuffer = NULL;
+    }
+
+    if (this->binaryOutput)
+    {
+        delete this->binaryOutput;
+        this->binaryOutput = NULL;
+    }
+
     this->mode = TRACING_MODE_NONE;
+    this->reportedDropCount = 0;
+
+    //The next trace starts with all registers:
+    memset(this->lastRegisters, 0, sizeof(this->lastRegisters));
 }
 
 
@@ -53,44 +70,192 @@ void Tracer::selectStdout()
 }
 
 
-void Tracer::selectFile(string filePath)
+void Tracer::selectFile(string filePath, int compression)
 {
-    //Create a new stream:
-    ofstream* stream = new ofstream(filePath, ofstream::out);
+    //Create the file:
+    int file = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
 
-    //Check it:
-    if (!stream)
-    {
-        throw runtime_error("Failed to allocate new ofstream.");
-    }
-
-    if (stream->fail())
+    if (file < 0)
     {
         throw runtime_error("Opening the file for writing has failed.");
     }
 
+    //Create a new stream on a buffer that is written on its own thread:
+    AsyncWriterBuffer* buffer = new AsyncWriterBuffer(file, this->overflow, compression, TRACE_FILE_BLOCK_BYTES);
+    ostream* stream = new ostream(buffer);
+
     //Close old one:
     closeOutput();
 
     //Assign:
+    this->fileBuffer = buffer;
     this->output = stream;
     this->mode = TRACING_MODE_FILE;
 }
 
 
+void Tracer::selectBinaryFile(string filePath, int compression)
+{
+    //Create the file:
+    TraceFileWriter* writer = new TraceFileWriter(filePath, this->overflow, compression);
+
+    //Close old one:
+    closeOutput();
+
+    //Assign:
+    this->binaryOutput = writer;
+    this->mode = TRACING_MODE_BINARY;
+}
+
+
+void Tracer::setTracingActive(bool flag)
+{
+    this->active = flag;
+
+    //The lines are not flushed one by one, so do it when the trace ends:
+    if (!flag)
+    {
+        flush();
+    }
+}
+
+
+void Tracer::flush()
+{
+    try
+    {
+        if (this->output)
+        {
+            this->output->flush();
+
+            if (this->output->bad())
+            {
+                throw runtime_error("Writing the trace file has failed.");
+            }
+        }
+
+        if (this->binaryOutput)
+        {
+            this->binaryOutput->flush();
+        }
+    }
+    catch (const runtime_error& rt)
+    {
+        cout << "Failed to write the trace: " << rt.what() << endl;
+    }
+
+    //Tell about the blocks the writer had to drop:
+    word dropCount = getDroppedCount();
+
+    if (dropCount > this->reportedDropCount)
+    {
+        cout << "The disk could not keep up, " << (dropCount - this->reportedDropCount) << " block(s) of the trace were dropped." << endl;
+        this->reportedDropCount = dropCount;
+    }
+}
+
+
+word Tracer::getDroppedCount() const
+{
+    if (this->fileBuffer)
+    {
+        return this->fileBuffer->getWriter().getDroppedCount();
+    }
+
+    if (this->binaryOutput)
+    {
+        return this->binaryOutput->getWriter().getDroppedCount();
+    }
+
+    return 0;
+}
+
+
+word Tracer::getDroppedBytes() const
+{
+    if (this->fileBuffer)
+    {
+        return this->fileBuffer->getWriter().getDroppedBytes();
+    }
+
+    if (this->binaryOutput)
+    {
+        return this->binaryOutput->getWriter().getDroppedBytes();
+    }
+
+    return 0;
+}
+
+
+void Tracer::writeLine(word ip, const Mnemonic& mnemonic, const struct user_regs_struct* registers)
+{
+    //No endl, flushing every line is way too slow:
+    *(this->output) << "\t0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << ip << dec << "\t" << mnemonic.getAssembly();
+
+    //The registers that changed since the last step:
+    if (registers)
+    {
+        const word* current = (const word*)registers;
+        string changes;
+
+        appendRegisters(changes, current, getChangedRegisters(this->lastRegisters, current));
+        memcpy(this->lastRegisters, current, sizeof(this->lastRegisters));
+
+        *(this->output) << changes;
+    }
+
+    *(this->output) << '\n';
+}
+
+
 void Tracer::trace(Mnemonic& mnemonic, const struct user_regs_struct& registers)
 {
-    UNUSED(registers);
+    if (this->mode == TRACING_MODE_NONE)
+    {
+        return;
+    }
 
-    if ((this->mode == TRACING_MODE_NONE) || !this->output)
+    //Try to write to the stream or the binary file:
+    try
+    {
+        if (this->binaryOutput)
+        {
+            this->binaryOutput->trace(registers.REG_IP, mnemonic, this->recordRegisters ? &registers : NULL);
+        }
+        else if (this->output)
+        {
+            writeLine(registers.REG_IP, mnemonic, this->recordRegisters ? &registers : NULL);
+        }
+    }
+    catch (...)
+    {
+        //Ignoring errors here ...
+    }
+}
+
+
+void Tracer::traceBlock(const vector<word>& addresses, const vector<Mnemonic>& mnemonics, const struct user_regs_struct* registers)
+{
+    if (this->mode == TRACING_MODE_NONE)
     {
         return;
     }
 
-    //Try to write to the ofstream:
+    //Try to write to the stream or the binary file:
     try
     {
-        *(this->output) << "\t0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << registers.REG_IP << dec << "\t" << mnemonic.getAssemblyString() << endl;
+        if (this->binaryOutput)
+        {
+            this->binaryOutput->traceBlock(addresses, mnemonics, this->recordRegisters ? registers : NULL);
+        }
+        else if (this->output)
+        {
+            //Every instruction after the start is a step, the registers are known at the target only:
+            for (size_t i = 1; i < addresses.size(); i++)
+            {
+                writeLine(addresses[i], mnemonics[i], (this->recordRegisters && (i + 1 == addresses.size())) ? registers : NULL);
+            }
+        }
     }
     catch (...)
     {
@@ -3,10 +3,15 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <sys/user.h>
 
 #include "Globals.hpp"
 #include "Mnemonic.hpp"
+#include "TraceFile.hpp"
+
+//The zlib level of "trace mode file <path> compress":
+#define TRACE_DEFAULT_COMPRESSION 6
 
 using namespace std;
 
@@ -15,7 +20,8 @@ enum TracingMode
 {
     TRACING_MODE_NONE,
     TRACING_MODE_STDOUT,
-    TRACING_MODE_FILE
+    TRACING_MODE_FILE,
+    TRACING_MODE_BINARY
 };
 
 class Tracer
@@ -32,7 +38,28 @@ private:
     //The current output stream:
     ostream* output;
 
+    //The buffer of a text trace file (written on its own thread):
+    AsyncWriterBuffer* fileBuffer;
+
+    //The binary trace file:
+    TraceFileWriter* binaryOutput;
+
+    //What to do if the disk cannot keep up:
+    AsyncWriterOverflow overflow;
+
+    //The number of dropped blocks that was reported already:
+    word reportedDropCount;
+
+    //Are the changed registers traced as well (and their last values for the text modes)?
+    bool recordRegisters;
+    word lastRegisters[REGISTER_COUNT];
+
     //Methods:
+private:
+
+    //Write a step to the text output (registers can be NULL):
+    void writeLine(word ip, const Mnemonic& mnemonic, const user_regs_struct* registers);
+
 public:
 
     //Get the tracing mode:
@@ -40,7 +67,19 @@ public:
 
     //Get/Set active flag:
     inline bool getTracingActive() const { return this->active; }
-    inline void setTracingActive(bool flag) { this->active = flag; }
+    void setTracingActive(bool flag);
+
+    //Get/Set what happens if the disk cannot keep up (applies to the next file):
+    inline AsyncWriterOverflow getOverflow() const { return this->overflow; }
+    inline void setOverflow(AsyncWriterOverflow overflow) { this->overflow = overflow; }
+
+    //Get/Set whether the changed registers are traced:
+    inline bool getRecordRegisters() const { return this->recordRegisters; }
+    inline void setRecordRegisters(bool flag) { this->recordRegisters = flag; }
+
+    //Get the number of dropped blocks resp. bytes of the current file:
+    word getDroppedCount() const;
+    word getDroppedBytes() const;
 
     //Constructor:
     Tracer();
@@ -51,12 +90,19 @@ public:
     //Close the output:
     void closeOutput();
 
-    //Select the output:
+    //Select the output (files can be compressed with a zlib level):
     void selectStdout();
-    void selectFile(string filePath);
+    void selectFile(string filePath, int compression = ASYNC_WRITER_UNCOMPRESSED);
+    void selectBinaryFile(string filePath, int compression = ASYNC_WRITER_UNCOMPRESSED);
+
+    //Write everything that is buffered:
+    void flush();
 
     //Trace a mnemonic with address and registers:
     void trace(Mnemonic& mnemonic, const user_regs_struct& registers);
+
+    //Trace a block from its start over the taken branch to the target (the registers are the ones at the target, NULL if unknown):
+    void traceBlock(const vector<word>& addresses, const vector<Mnemonic>& mnemonics, const user_regs_struct* registers);
 };
 
 #endif // TRACER_H
@@ -0,0 +1,269 @@
+#include "ValueScanner.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "PatternScanner.hpp"
+#include "Tracee.hpp"
+
+void ValueCandidates::add(word address, const byte* value, int width)
+{
+    word page = address & ~((word)PAGE_SIZE_BYTES - 1);
+
+    //A new page?
+    if (this->pages.empty() || (this->pages.back() != page))
+    {
+        this->pages.push_back(page);
+        this->pageFirsts.push_back(this->offsets.size());
+    }
+
+    this->offsets.push_back((uint16_t)(address - page));
+    this->values.insert(this->values.end(), value, value + width);
+}
+
+
+word ValueCandidates::findPage(word index) const
+{
+    //The last page starting at or before the candidate:
+    return (upper_bound(this->pageFirsts.begin(), this->pageFirsts.end(), index) - this->pageFirsts.begin()) - 1;
+}
+
+
+void ValueCandidates::clear()
+{
+    this->pages.clear();
+    this->pageFirsts.clear();
+    this->offsets.clear();
+    this->values.clear();
+}
+
+
+ValueScanner::ValueScanner()
+    : width(0), truncated(false)
+{
+
+}
+
+
+void ValueScanner::clear()
+{
+    this->width = 0;
+    this->truncated = false;
+    this->candidates.clear();
+}
+
+
+uint64_t ValueScanner::loadValue(const byte* ptr) const
+{
+    switch (this->width)
+    {
+    case 1: return *ptr;
+    case 2: { uint16_t value; memcpy(&value, ptr, 2); return value; }
+    case 4: { uint32_t value; memcpy(&value, ptr, 4); return value; }
+    default: { uint64_t value; memcpy(&value, ptr, 8); return value; }
+    }
+}
+
+
+bool ValueScanner::matches(ValueScanMode mode, uint64_t previous, uint64_t current, uint64_t value) const
+{
+    switch (mode)
+    {
+    case VALUE_SCAN_EQUAL: return current == value;
+    case VALUE_SCAN_CHANGED: return current != previous;
+    case VALUE_SCAN_UNCHANGED: return current == previous;
+    case VALUE_SCAN_INCREASED: return current > previous;
+    case VALUE_SCAN_DECREASED: return current < previous;
+    }
+
+    return false;
+}
+
+
+void ValueScanner::scan(Tracee& tracee, const vector<MemoryRegion>& regions, uint64_t value, int width)
+{
+    clear();
+    this->width = width;
+
+    //The value is a byte pattern (little endian):
+    PatternScanner scanner = PatternScanner::fromString(string((const char*)&value, width));
+    vector<byte> data(VALUE_SCANNER_CHUNK_BYTES);
+    vector<word> offsets;
+
+    for (vector<MemoryRegion>::const_iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        //A range filter may have clipped the region at any address, so start at an aligned one.
+        //The chunk size is a multiple of the width, so aligned values never cross a chunk border:
+        word start = (it->start + width - 1) & ~(word)(width - 1);
+        word end = it->end & ~(word)(width - 1);
+
+        for (word chunkStart = start; chunkStart < end; chunkStart += VALUE_SCANNER_CHUNK_BYTES)
+        {
+            word count = min(end - chunkStart, (word)VALUE_SCANNER_CHUNK_BYTES);
+            word readCount = tracee.readMemoryDirect((pword)chunkStart, count, &data[0]);
+
+            offsets.clear();
+            scanner.find(&data[0], readCount, offsets);
+
+            for (vector<word>::iterator it2 = offsets.begin(); it2 != offsets.end(); ++it2)
+            {
+                if ((*it2 % width) != 0)
+                {
+                    continue;
+                }
+
+                //Enough:
+                if (getCount() >= VALUE_SCANNER_MAX_CANDIDATES)
+                {
+                    this->truncated = true;
+                    return;
+                }
+
+                this->candidates.add(chunkStart + *it2, &data[*it2], width);
+            }
+
+            if (readCount < count)
+            {
+                break;
+            }
+        }
+    }
+}
+
+
+bool ValueScanner::readGroupFallback(Tracee& tracee, word start, word length, byte* ptr)
+{
+    return tracee.readMemoryDirect((pword)start, length, ptr) == (int)length;
+}
+
+
+void ValueScanner::rescan(Tracee& tracee, ValueScanMode mode, uint64_t value)
+{
+    const ValueCandidates& candidates = this->candidates;
+    ValueCandidates newCandidates;
+    word count = getCount();
+    word index = 0;
+    word pageIndex = 0;
+    bool vmReadAvailable = true;
+
+    //One group is a run of nearby candidates in one page, it's read by one iovec:
+    struct iovec remote[IOV_MAX];
+    word groupPages[IOV_MAX];
+    word groupEnds[IOV_MAX];
+    bool groupRead[IOV_MAX];
+    vector<byte> buffer(IOV_MAX * PAGE_SIZE_BYTES);
+
+    while (index < count)
+    {
+        //Build a batch of groups:
+        int groupCount = 0;
+        word batchBytes = 0;
+        word batchStart = index;
+
+        while ((index < count) && (groupCount < IOV_MAX))
+        {
+            //The page of the candidate and where its candidates end:
+            while (((pageIndex + 1) < candidates.pages.size()) && (candidates.pageFirsts[pageIndex + 1] <= index))
+            {
+                pageIndex++;
+            }
+
+            word page = candidates.pages[pageIndex];
+            word pageEnd = ((pageIndex + 1) < candidates.pages.size()) ? candidates.pageFirsts[pageIndex + 1] : count;
+            word start = page + candidates.offsets[index];
+            word end = start + this->width;
+
+            for (index++; (index < pageEnd) && ((page + candidates.offsets[index]) < (end + VALUE_SCANNER_GAP_BYTES)); index++)
+            {
+                end = page + candidates.offsets[index] + this->width;
+            }
+
+            remote[groupCount].iov_base = (void*)start;
+            remote[groupCount].iov_len = end - start;
+            groupPages[groupCount] = page;
+            groupEnds[groupCount] = index;
+            groupRead[groupCount] = false;
+            groupCount++;
+
+            batchBytes += end - start;
+        }
+
+        //Read them (a failed iovec ends a transfer, so go on behind it):
+        int next = 0;
+        word offset = 0;
+
+        while (next < groupCount)
+        {
+            if (!vmReadAvailable)
+            {
+                groupRead[next] = readGroupFallback(tracee, (word)remote[next].iov_base, remote[next].iov_len, &buffer[offset]);
+                offset += remote[next].iov_len;
+                next++;
+
+                continue;
+            }
+
+            struct iovec local;
+            local.iov_base = &buffer[offset];
+            local.iov_len = batchBytes - offset;
+
+            ssize_t result = process_vm_readv(tracee.getPID(), &local, 1, &remote[next], groupCount - next, 0);
+
+            if ((result < 0) && ((errno == ENOSYS) || (errno == EPERM)))
+            {
+                vmReadAvailable = false;
+                continue;
+            }
+
+            //Mark the completely transferred groups:
+            word transferred = (result > 0) ? result : 0;
+
+            while ((next < groupCount) && (transferred >= remote[next].iov_len))
+            {
+                groupRead[next] = true;
+                transferred -= remote[next].iov_len;
+                offset += remote[next].iov_len;
+                next++;
+            }
+
+            //The next one is (partially) unreadable, the page is gone:
+            if (next < groupCount)
+            {
+                offset += remote[next].iov_len;
+                next++;
+            }
+        }
+
+        //Keep the matching candidates:
+        word candidate = batchStart;
+        offset = 0;
+
+        for (int group = 0; group < groupCount; group++)
+        {
+            word groupStart = (word)remote[group].iov_base;
+
+            for (; candidate < groupEnds[group]; candidate++)
+            {
+                if (!groupRead[group])
+                {
+                    continue;
+                }
+
+                word address = groupPages[group] + candidates.offsets[candidate];
+                const byte* current = &buffer[offset + (address - groupStart)];
+
+                if (matches(mode, loadValue(&candidates.values[candidate * this->width]), loadValue(current), value))
+                {
+                    newCandidates.add(address, current, this->width);
+                }
+            }
+
+            offset += remote[group].iov_len;
+        }
+    }
+
+    swap(this->candidates, newCandidates);
+}
@@ -0,0 +1,108 @@
+#ifndef VALUESCANNER_H
+#define VALUESCANNER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Globals.hpp"
+#include "MemoryMap.hpp"
+
+//Candidates closer than that are read with one iovec by a rescan:
+#define VALUE_SCANNER_GAP_BYTES 64
+
+//The number of bytes scanned at once by a full scan:
+#define VALUE_SCANNER_CHUNK_BYTES (4 * 1024 * 1024)
+
+//A full scan stops at that many candidates (a common value in a large heap would take too much memory):
+#define VALUE_SCANNER_MAX_CANDIDATES (32 * 1024 * 1024)
+
+using namespace std;
+
+class Tracee;
+
+//How a rescan narrows the candidates down:
+enum ValueScanMode
+{
+    VALUE_SCAN_EQUAL,
+    VALUE_SCAN_CHANGED,
+    VALUE_SCAN_UNCHANGED,
+    VALUE_SCAN_INCREASED,
+    VALUE_SCAN_DECREASED
+};
+
+//The candidates of a value scan, sorted by address.
+//They are stored page relative: each page holding candidates once, each candidate as its offset in there.
+//So a candidate takes 2 bytes plus its value instead of a whole address:
+struct ValueCandidates
+{
+    //The pages holding candidates and the index of the first candidate in each of them:
+    vector<word> pages;
+    vector<word> pageFirsts;
+
+    //The offsets of the candidates within their pages (aligned to the width):
+    vector<uint16_t> offsets;
+
+    //Their values when they were read last (width bytes each):
+    vector<byte> values;
+
+    //Add a candidate behind the others:
+    void add(word address, const byte* value, int width);
+
+    //Get the index of the page of a candidate:
+    word findPage(word index) const;
+
+    //Drop all of them:
+    void clear();
+};
+
+//Finds a value in memory and narrows the addresses down over several stops (like a cheat engine does):
+class ValueScanner
+{
+    //Members:
+private:
+
+    //The width of the values in bytes (1, 2, 4 or 8):
+    int width;
+
+    //The candidates:
+    ValueCandidates candidates;
+
+    //Did the last full scan stop at the maximum number of candidates?
+    bool truncated;
+
+    //Methods:
+private:
+
+    //Read a value of the current width:
+    uint64_t loadValue(const byte* ptr) const;
+
+    //Check a candidate:
+    bool matches(ValueScanMode mode, uint64_t previous, uint64_t current, uint64_t value) const;
+
+    //Read a group of candidates with the fallback (if process_vm_readv is not usable):
+    bool readGroupFallback(Tracee& tracee, word start, word length, byte* ptr);
+
+public:
+
+    //Getters:
+    inline int getWidth() const { return this->width; }
+    inline word getCount() const { return this->candidates.offsets.size(); }
+    inline word getAddress(word index) const { return this->candidates.pages[this->candidates.findPage(index)] + this->candidates.offsets[index]; }
+    inline uint64_t getValue(word index) const { return loadValue(&this->candidates.values[index * this->width]); }
+    inline bool isTruncated() const { return this->truncated; }
+
+    //Constructor:
+    ValueScanner();
+
+    //Drop all candidates:
+    void clear();
+
+    //Find all aligned occurrences of a value in some regions (this replaces the candidates):
+    void scan(Tracee& tracee, const vector<MemoryRegion>& regions, uint64_t value, int width);
+
+    //Read the candidates again and keep the matching ones.
+    //Nearby candidates are coalesced into one iovec and many of them are read with one process_vm_readv:
+    void rescan(Tracee& tracee, ValueScanMode mode, uint64_t value);
+};
+
+#endif // VALUESCANNER_H
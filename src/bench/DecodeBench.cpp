@@ -0,0 +1,191 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "Disassembler.hpp"
+#include "Globals.hpp"
+#include "Mnemonic.hpp"
+
+#define PACKAGE 1
+#define PACKAGE_VERSION 1
+#include <bfd.h>
+
+#include <dis-asm.h>
+
+using namespace std;
+
+//The default number of passes over the code:
+#define DEFAULT_PASSES 20000
+
+//The ways of decoding that are measured:
+enum DecodeMode
+{
+    DECODE_MODE_BASELINE,
+    DECODE_MODE_FULL,
+    DECODE_MODE_LENGTH
+};
+
+//A fixed piece of code (a typical function: prologue, loads and stores, a loop, a call and the epilogue):
+static const byte code[] =
+{
+    0x55,                                       //push rbp
+    0x48, 0x89, 0xe5,                           //mov rbp, rsp
+    0x41, 0x54,                                 //push r12
+    0x53,                                       //push rbx
+    0x48, 0x83, 0xec, 0x20,                     //sub rsp, 0x20
+    0x48, 0x89, 0x7d, 0xd8,                     //mov [rbp-0x28], rdi
+    0x89, 0x75, 0xd4,                           //mov [rbp-0x2c], esi
+    0xc7, 0x45, 0xec, 0x00, 0x00, 0x00, 0x00,   //mov dword [rbp-0x14], 0
+    0xeb, 0x1d,                                 //jmp +0x1d
+    0x8b, 0x45, 0xec,                           //mov eax, [rbp-0x14]
+    0x48, 0x63, 0xd0,                           //movsxd rdx, eax
+    0x48, 0x8b, 0x45, 0xd8,                     //mov rax, [rbp-0x28]
+    0x48, 0x01, 0xd0,                           //add rax, rdx
+    0x0f, 0xb6, 0x00,                           //movzx eax, byte [rax]
+    0x0f, 0xbe, 0xc0,                           //movsx eax, al
+    0x89, 0xc7,                                 //mov edi, eax
+    0xe8, 0x00, 0x00, 0x00, 0x00,               //call +0
+    0x83, 0x45, 0xec, 0x01,                     //add dword [rbp-0x14], 1
+    0x8b, 0x45, 0xec,                           //mov eax, [rbp-0x14]
+    0x3b, 0x45, 0xd4,                           //cmp eax, [rbp-0x2c]
+    0x7c, 0xdb,                                 //jl -0x25
+    0xf3, 0x0f, 0x10, 0x05, 0x10, 0x00, 0x00, 0x00, //movss xmm0, [rip+0x10]
+    0x48, 0x83, 0xc4, 0x20,                     //add rsp, 0x20
+    0x5b,                                       //pop rbx
+    0x41, 0x5c,                                 //pop r12
+    0x5d,                                       //pop rbp
+    0xc3                                        //ret
+};
+
+//Decode one instruction the way it was done before the reusable context
+//(a fresh context and a memory stream per instruction, the text is written with fprintf):
+static int decodeBaseline(const byte* buffer, int length, string& text)
+{
+    //The instruction is read into a buffer of the max size (like from a tracee):
+    byte instruction[MAX_INSTRUCTION_BYTES];
+    memset(instruction, 0, MAX_INSTRUCTION_BYTES);
+    memcpy(instruction, buffer, (length < MAX_INSTRUCTION_BYTES) ? length : MAX_INSTRUCTION_BYTES);
+
+    //Open a memory stream:
+    char stringBuffer[256];
+    FILE* memStream = fmemopen(stringBuffer, 256, "w");
+
+    if (!memStream)
+    {
+        throw runtime_error("Failed to open memory stream.");
+    }
+
+    //Prepare disassembly info (bfd):
+    struct disassemble_info info;
+    init_disassemble_info(&info, memStream, (fprintf_ftype)fprintf);
+
+    info.buffer = (bfd_byte*)instruction;
+    info.buffer_length = MAX_INSTRUCTION_BYTES;
+    info.arch = bfd_arch_i386;
+    info.endian = BFD_ENDIAN_LITTLE;
+
+#ifdef __i386__
+    info.mach = bfd_mach_i386_i386_intel_syntax;
+#elif __amd64__
+    info.mach = bfd_mach_x86_64_intel_syntax;
+#endif
+
+    int opcodeLength = print_insn_i386_intel(0, &info);
+
+    //Close the stream:
+    fclose(memStream);
+
+    text = stringBuffer;
+
+    return opcodeLength;
+}
+
+
+//Decode the whole code once and return the number of instructions:
+static int decodeAll(Disassembler& disassembler, DecodeMode mode, word& checksum)
+{
+    int count = 0;
+    int offset = 0;
+
+    while (offset < (int)sizeof(code))
+    {
+        int length;
+
+        if (mode == DECODE_MODE_BASELINE)
+        {
+            string text;
+            length = decodeBaseline(code + offset, sizeof(code) - offset, text);
+            checksum += text.size();
+        }
+        else if (mode == DECODE_MODE_FULL)
+        {
+            Mnemonic mnemonic = disassembler.decode(code + offset, sizeof(code) - offset, false);
+            length = mnemonic.getOpcodeLength();
+            checksum += mnemonic.getAssemblyString().size();
+        }
+        else
+        {
+            length = disassembler.decodeLength(code + offset, sizeof(code) - offset);
+        }
+
+        checksum += length;
+        offset += length;
+        count++;
+    }
+
+    return count;
+}
+
+
+//Measure one mode and print the cost per instruction:
+static void measure(Disassembler& disassembler, DecodeMode mode, int passes)
+{
+    word checksum = 0;
+    long instructions = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (int i = 0; i < passes; i++)
+    {
+        instructions += decodeAll(disassembler, mode, checksum);
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    const char* names[] = { "baseline:    ", "full:        ", "length only: " };
+
+    cout << names[mode] << instructions << " instructions in " << fixed << setprecision(3) << seconds << " s, "
+         << setprecision(1) << (seconds * 1e9 / instructions) << " ns per instruction (checksum " << checksum << ")" << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+    //The number of passes over the code:
+    int passes = (argc > 1) ? atoi(argv[1]) : DEFAULT_PASSES;
+
+    if (passes <= 0)
+    {
+        cout << "Usage: decodebench [passes]" << endl;
+        return 1;
+    }
+
+    //One reusable context like the one of a tracee:
+    Disassembler disassembler;
+
+    //Warm up, then measure all modes (on the same code and with the same syntax):
+    word checksum = 0;
+    decodeAll(disassembler, DECODE_MODE_BASELINE, checksum);
+    decodeAll(disassembler, DECODE_MODE_FULL, checksum);
+
+    measure(disassembler, DECODE_MODE_BASELINE, passes);
+    measure(disassembler, DECODE_MODE_FULL, passes);
+    measure(disassembler, DECODE_MODE_LENGTH, passes);
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+#define PACKAGE 1
+#define PACKAGE_VERSION 1
+#include <bfd.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <link.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ElfImage.hpp"
+#include "Globals.hpp"
+#include "SymbolTable.hpp"
+
+using namespace std;
+
+//The default number of runs per method (the best one counts):
+#define DEFAULT_RUNS 5
+
+//Build the whole table in place (the cache is disabled) and return the number of symbols:
+static long loadTable(const string& path)
+{
+    SymbolTable table(path);
+    return table.size();
+}
+
+
+//Only read the symbols from the mapped binary (the part libbfd did before) and return their number:
+static long readInPlace(const string& path, word& checksum)
+{
+    ElfImage image(path);
+    vector<ElfImageSymbolSection> sections = image.getSymbolSections();
+    const char* data = (const char*)image.getData();
+    long count = 0;
+
+    for (vector<ElfImageSymbolSection>::iterator it = sections.begin(); it != sections.end(); ++it)
+    {
+        const ElfW(Sym)* entries = (const ElfW(Sym)*)it->symbols;
+
+        //Touch every name and value like the table does:
+        for (word i = 1; i < it->count; i++)
+        {
+            if (entries[i].st_name < it->stringsSize)
+            {
+                checksum += strnlen(data + it->stringsOffset + entries[i].st_name, it->stringsSize - entries[i].st_name) + entries[i].st_value;
+            }
+        }
+
+        count += it->count;
+    }
+
+    return count;
+}
+
+
+//Only read the symbols with libbfd like the table did before and return their number:
+static long readBfd(const string& path, word& checksum)
+{
+    bfd* descr = bfd_openr(path.c_str(), NULL);
+
+    if (!descr || !bfd_check_format(descr, bfd_object))
+    {
+        throw runtime_error("libbfd can't read the binary.");
+    }
+
+    long symbolTableSize = bfd_get_symtab_upper_bound(descr);
+    asymbol** symbolTable = (asymbol**)malloc((symbolTableSize > 0) ? symbolTableSize : 1);
+    long symbolTableCount = (symbolTableSize > 0) ? bfd_canonicalize_symtab(descr, symbolTable) : 0;
+
+    //Touch every name and value like the table does:
+    for (long i = 0; i < symbolTableCount; i++)
+    {
+        if (symbolTable[i]->name)
+        {
+            checksum += strlen(bfd_asymbol_name(symbolTable[i])) + (word)bfd_asymbol_value(symbolTable[i]);
+        }
+    }
+
+    free(symbolTable);
+    bfd_close(descr);
+
+    return symbolTableCount;
+}
+
+
+//Run a method several times and print the best time:
+template <typename Method> static void measure(const char* name, int runs, Method method)
+{
+    double best = 0;
+    long count = 0;
+
+    for (int i = 0; i < runs; i++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        count = method();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        best = ((i == 0) || (seconds < best)) ? seconds : best;
+    }
+
+    cout << name << count << " symbols, best of " << runs << ": " << fixed << setprecision(3) << best << " s" << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        cout << "Usage: symbolbench <path to binary> [runs]" << endl;
+        return 1;
+    }
+
+    string path = argv[1];
+    int runs = (argc > 2) ? atoi(argv[2]) : DEFAULT_RUNS;
+
+    if (runs <= 0)
+    {
+        runs = DEFAULT_RUNS;
+    }
+
+    //Without a cache directory nothing is cached, so every run parses:
+    unsetenv("XDG_CACHE_HOME");
+    unsetenv("HOME");
+
+    try
+    {
+        word checksum = 0;
+
+        //The reading is what changed, building the table is the same for both:
+        measure("reading in place:    ", runs, [&]() { return readInPlace(path, checksum); });
+        measure("reading with libbfd: ", runs, [&]() { return readBfd(path, checksum); });
+        measure("whole table:         ", runs, [&]() { return loadTable(path); });
+
+        //Keeps the reading from being optimized away:
+        cout << "(checksum " << checksum << ")" << endl;
+    }
+    catch (const runtime_error& err)
+    {
+        cout << err.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,5 +1,18 @@
 #include "commands/Command.hpp"
 
+bool Command::isStaticCapable()
+{
+    //Most commands need a process:
+    return false;
+}
+
+
+void Command::waitIdle()
+{
+    //Most commands have no threads.
+}
+
+
 Command::~Command()
 {
 
@@ -25,6 +25,12 @@ public:
     //Invoke the command:
     virtual void invoke(DebugLoop& loop, vector<string>& args) = 0;
 
+    //Can the command be used in static mode (without a process)?
+    virtual bool isStaticCapable();
+
+    //Wait until no thread of the command works in the background (e.g. before forking):
+    virtual void waitIdle();
+
     //Destructor:
     virtual ~Command();
 };
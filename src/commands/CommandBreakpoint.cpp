@@ -81,17 +81,12 @@ void CommandBreakpoint::invoke(DebugLoop& loop, vector<string>& args)
             return;
         }
 
-        //Check if the symbol exists:
-        const SymbolTableMap& syms = loop.getTracee().getSymbolTable()->getMap();
-
-        if (syms.find(args[1]) == syms.end())
+        //Check if the symbol exists (in the binary or a shared object) and get its address:
+        if (!loop.getTracee().findSymbol(args[1], address))
         {
             cout << "Symbol \"" << args[1] << "\" not found." << endl;
             return;
         }
-
-        //Get its address:
-        address = (word)(syms.at(args[1])->getAddress());
     }
     //Param address:
     else
@@ -107,7 +102,7 @@ void CommandBreakpoint::invoke(DebugLoop& loop, vector<string>& args)
         istringstream(args[1]) >> hex >> address;
     }
 
-    //Maybe get base:
+    //Maybe get base (symbols of the binary are relocated automatically, this overrides it):
     if (args.size() >= 3)
     {
         if (args[2] == "base")
@@ -123,6 +118,20 @@ void CommandBreakpoint::invoke(DebugLoop& loop, vector<string>& args)
             word base = 0;
             istringstream(args[3]) >> hex >> base;
 
+            //Replace the load bias by it:
+            if (action == 2)
+            {
+                const Symbol* symbol = loop.getTracee().getSymbolTable()->find(args[1]);
+
+                if (!symbol)
+                {
+                    cout << "A base only applies to symbols of the binary." << endl;
+                    return;
+                }
+
+                address = symbol->address;
+            }
+
             //Add it:
             address += base;
         }
@@ -1,11 +1,18 @@
 #include "CommandDisassemble.hpp"
 
+#include <fcntl.h>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
 #include <vector>
 
+#include "ElfImage.hpp"
 #include "Mnemonic.hpp"
+#include "ParallelDisassembler.hpp"
+#include "SymbolTable.hpp"
 
 vector<string> CommandDisassemble::getCommandStrings()
 {
@@ -13,6 +20,187 @@ vector<string> CommandDisassemble::getCommandStrings()
 }
 
 
+bool CommandDisassemble::isStaticCapable()
+{
+    return true;
+}
+
+
+void CommandDisassemble::invokeRegion(DebugLoop& loop, vector<string>& args)
+{
+    //Name needed:
+    if (args.size() < 2)
+    {
+        cout << "Command syntax: \"disassemble <section|function> <name> [att] [file <path>]\"." << endl;
+        return;
+    }
+
+    //Read the optional params:
+    bool att = false;
+    string filePath = "";
+
+    for (unsigned int i = 2; i < args.size(); i++)
+    {
+        if (args[i] == "att")
+        {
+            att = true;
+        }
+        else if (args[i] == "file")
+        {
+            //Value needed:
+            if (i == (args.size() - 1))
+            {
+                cout << "Parameter \"file\" needs a path." << endl;
+                return;
+            }
+
+            filePath = args[++i];
+        }
+        else
+        {
+            cout << "Unknown parameter: \"" << args[i] << "\"." << endl;
+            return;
+        }
+    }
+
+    const SymbolTable* symbols = loop.getTracee().getSymbolTable();
+    word bias = loop.getTracee().getLoadBias();
+    word address = 0;
+    word size = 0;
+
+    try
+    {
+        //Section (from the section headers of the binary):
+        if (args[0] == "section")
+        {
+            bool found = false;
+
+            if (loop.getTracee().getImage())
+            {
+                found = loop.getTracee().getImage()->findSection(args[1], address, size);
+            }
+            else
+            {
+                ElfImage image(loop.getTracee().getPath());
+                found = image.findSection(args[1], address, size);
+            }
+
+            if (!found)
+            {
+                cout << "Section \"" << args[1] << "\" not found." << endl;
+                return;
+            }
+
+            address += bias;
+        }
+        //Function (its symbol size, up to the next symbol if it has none):
+        else
+        {
+            const Symbol* symbol = symbols->find(args[1]);
+
+            if (!symbol)
+            {
+                cout << "Symbol \"" << args[1] << "\" not found." << endl;
+                return;
+            }
+
+            address = symbol->address;
+
+            //Symbols outside of the address index (e.g. of other types) still end at the next symbol:
+            if (!symbols->getSize(address, size))
+            {
+                word end = 0;
+
+                for (const Symbol* it = symbols->begin(); it != symbols->end(); ++it)
+                {
+                    word symbolAddress = it->address;
+
+                    if ((symbolAddress > address) && ((end == 0) || (symbolAddress < end)))
+                    {
+                        end = symbolAddress;
+                    }
+                }
+
+                if (end == 0)
+                {
+                    cout << "Failed to determine the end of \"" << args[1] << "\"." << endl;
+                    return;
+                }
+
+                size = end - address;
+            }
+
+            address += bias;
+        }
+
+        //Read the code at once (padded for the last instruction):
+        vector<byte> code(size + MAX_INSTRUCTION_BYTES, 0);
+        word readSize = loop.getTracee().readMemory((pword)address, size, &code[0]);
+
+        if (readSize == 0)
+        {
+            cout << "Failed to read the code at 0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << address << dec << "." << endl;
+            return;
+        }
+
+        if (readSize < size)
+        {
+            cout << "Only 0x" << hex << readSize << " of 0x" << size << dec << " bytes are readable." << endl;
+            size = readSize;
+        }
+
+        //Split at the symbols (they start instructions):
+        ParallelDisassembler disassembler(&code[0], address, size, att, symbols, bias);
+        vector<word> boundaries;
+
+        for (const Symbol* it = symbols->begin(); it != symbols->end(); ++it)
+        {
+            boundaries.push_back(it->address + bias);
+        }
+
+        disassembler.split(boundaries);
+
+        //The workers are forked, so nothing may be running on our other threads:
+        loop.quiesceThreads();
+
+        //Write to stdout or a file:
+        if (filePath.empty())
+        {
+            cout.flush();
+            disassembler.run(STDOUT_FILENO);
+        }
+        else
+        {
+            int file = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+            if (file < 0)
+            {
+                cout << "Failed to open \"" << filePath << "\" (open error code: " << strerror(errno) << ")." << endl;
+                return;
+            }
+
+            try
+            {
+                disassembler.run(file);
+            }
+            catch (...)
+            {
+                close(file);
+                throw;
+            }
+
+            close(file);
+            cout << "Disassembly of 0x" << hex << size << dec << " bytes written to \"" << filePath << "\"." << endl;
+        }
+    }
+    catch (const runtime_error& err)
+    {
+        cout << err.what() << endl;
+        return;
+    }
+}
+
+
 void CommandDisassemble::invoke(DebugLoop& loop, vector<string>& args)
 {
     //Always keep prompting:
@@ -24,12 +212,21 @@ void CommandDisassemble::invoke(DebugLoop& loop, vector<string>& args)
         cout << "The first parameter must be a number specifying the number of instructions to disassemble (e.g. \"disassemble 10\")." << endl;
         cout << "Optional parameters may follow:" << endl;
         cout << "\t\"addr <address>\" to specify a starting address" << endl;
+        cout << "\t\"sym <symbol>\" to start at a symbol" << endl;
         cout << "\t\"att\" to use AT&T assembler flavor instead of Intel" << endl;
         cout << "\t\"obj\" to use pure object code instead of Intel" << endl;
+        cout << "Whole sections resp. functions are disassembled in parallel with \"disassemble <section|function> <name> [att] [file <path>]\"." << endl;
 
         return;
     }
 
+    //Whole regions:
+    if ((args[0] == "section") || (args[0] == "function"))
+    {
+        invokeRegion(loop, args);
+        return;
+    }
+
     //Get the number of instructions to disassemble:
     int instructionCount = 0;
 
@@ -78,6 +275,35 @@ void CommandDisassemble::invoke(DebugLoop& loop, vector<string>& args)
             //Address param has appeared now:
             addressParamAppeared = true;
         }
+        //Symbol address:
+        else if (args[i] == "sym")
+        {
+            //Only one address param:
+            if (addressParamAppeared)
+            {
+                cout << "Only one address parameter is allowed." << endl;
+                return;
+            }
+
+            //Value needed:
+            if (i == (args.size() - 1))
+            {
+                cout << "Parameter \"sym\" needs a symbol name." << endl;
+                return;
+            }
+
+            //Check if the symbol exists (in the binary or a shared object) and get its address:
+            string symbolName = args[++i];
+
+            if (!loop.getTracee().findSymbol(symbolName, address))
+            {
+                cout << "Symbol \"" << symbolName << "\" not found." << endl;
+                return;
+            }
+
+            //Address param has appeared now:
+            addressParamAppeared = true;
+        }
         //Format AT&T flavor:
         else if (args[i] == "att")
         {
@@ -115,18 +341,26 @@ void CommandDisassemble::invoke(DebugLoop& loop, vector<string>& args)
     try
     {
         int totalLength = 0;
-        vector<Mnemonic> mnemonics = loop.getTracee().disassemble((pword)address, att, instructionCount, totalLength);
-
+        vector<Mnemonic> mnemonics = obj ? loop.getTracee().decodeOpcodes((pword)address, instructionCount, totalLength) : loop.getTracee().disassemble((pword)address, att, instructionCount, totalLength);
         for (vector<Mnemonic>::iterator it = mnemonics.begin(); it != mnemonics.end(); ++it)
         {
             //Get the mnemonic:
             Mnemonic mnemonic = *it;
 
+            //Label the start of every symbol (and the symbol of the first instruction):
+            const char* name = NULL;
+            word offset = 0;
+
+            if (loop.getTracee().lookupSymbol(address, name, offset) && ((offset == 0) || (it == mnemonics.begin())))
+            {
+                cout << "<" << ((offset == 0) ? string(name) : loop.getTracee().describeAddress(address)) << ">:" << endl;
+            }
+
             //Object code or assembly?
             if (!obj)
             {
                 //Print the address and the disassembly:
-                cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << address << dec << ">\t" << mnemonic.getAssemblyString() << endl;
+                cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << address << dec << ">\t" << mnemonic.getAssembly() << endl;
             }
             else
             {
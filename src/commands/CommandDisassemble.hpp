@@ -11,6 +11,11 @@ using namespace std;
 class CommandDisassemble: public Command
 {
     //Methods:
+private:
+
+    //Disassemble a whole section or function in parallel:
+    void invokeRegion(DebugLoop& loop, vector<string>& args);
+
 public:
 
     //Return the command strings the command should be registered for:
@@ -18,6 +23,9 @@ public:
 
     //Invoke the command:
     virtual void invoke(DebugLoop& loop, vector<string>& args);
+
+    //Can the command be used in static mode (without a process)?
+    virtual bool isStaticCapable();
 };
 
 #endif // COMMANDDISASSEMBLE_H
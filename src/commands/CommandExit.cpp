@@ -8,10 +8,25 @@ vector<string> CommandExit::getCommandStrings()
 }
 
 
+bool CommandExit::isStaticCapable()
+{
+    return true;
+}
+
+
 void CommandExit::invoke(DebugLoop& loop, vector<string>& args)
 {
     UNUSED(args);
 
+    //Nothing to kill in static mode:
+    if (loop.getTracee().isStatic())
+    {
+        loop.setShowPrompt(false);
+        loop.setKeepLooping(false);
+
+        return;
+    }
+
     //Log:
     cout << "Killing the debugged process ..." << endl;
 
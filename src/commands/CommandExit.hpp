@@ -18,6 +18,9 @@ public:
 
     //Invoke the command:
     virtual void invoke(DebugLoop& loop, vector<string>& args);
+
+    //Can the command be used in static mode (without a process)?
+    virtual bool isStaticCapable();
 };
 
 #endif // COMMANDEXIT_H
@@ -1,6 +1,100 @@
 #include "CommandMemory.hpp"
 
+#include <algorithm>
+#include <ctype.h>
+#include <fcntl.h>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+
+#include "ElfImage.hpp"
+#include "PatternScanner.hpp"
+#include "ReferenceScanner.hpp"
+
+//Write a buffer completely:
+static bool writeAll(int file, const char* data, size_t size)
+{
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t count = write(file, data + written, size - written);
+
+        if (count <= 0)
+        {
+            return false;
+        }
+
+        written += count;
+    }
+
+    return true;
+}
+
+
+//Format a hex dump of some bytes into a buffer (one line per MEMORY_COMMAND_LINE_BYTES bytes):
+static void formatHexDump(word address, const byte* data, word count, vector<char>& text)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    //"\t<0x" + address + ">\t" + 3 chars per byte + "\t|" + 1 char per byte + "|\n":
+    text.resize(count / MEMORY_COMMAND_LINE_BYTES * (2 * WORD_SIZE_BYTES + 11 + 4 * MEMORY_COMMAND_LINE_BYTES) + 2 * WORD_SIZE_BYTES + 11 + 4 * MEMORY_COMMAND_LINE_BYTES);
+    char* out = &text[0];
+
+    for (word line = 0; line < count; line += MEMORY_COMMAND_LINE_BYTES)
+    {
+        word lineBytes = min((word)MEMORY_COMMAND_LINE_BYTES, count - line);
+
+        //The address:
+        *out++ = '\t';
+        *out++ = '<';
+        *out++ = '0';
+        *out++ = 'x';
+
+        for (int shift = WORD_SIZE_BITS - 4; shift >= 0; shift -= 4)
+        {
+            *out++ = digits[((address + line) >> shift) & 0xf];
+        }
+
+        *out++ = '>';
+        *out++ = '\t';
+
+        //The bytes (padded on a short last line):
+        for (word i = 0; i < MEMORY_COMMAND_LINE_BYTES; i++)
+        {
+            if (i < lineBytes)
+            {
+                *out++ = digits[data[line + i] >> 4];
+                *out++ = digits[data[line + i] & 0xf];
+            }
+            else
+            {
+                *out++ = ' ';
+                *out++ = ' ';
+            }
+
+            *out++ = ' ';
+        }
+
+        //The printable characters:
+        *out++ = '\t';
+        *out++ = '|';
+
+        for (word i = 0; i < lineBytes; i++)
+        {
+            *out++ = ((data[line + i] >= 0x20) && (data[line + i] < 0x7f)) ? (char)data[line + i] : '.';
+        }
+
+        *out++ = '|';
+        *out++ = '\n';
+    }
+
+    text.resize(out - &text[0]);
+}
+
 
 vector<string> CommandMemory::getCommandStrings()
 {
@@ -8,12 +102,796 @@ vector<string> CommandMemory::getCommandStrings()
 }
 
 
-void CommandMemory::invoke(DebugLoop& loop, vector<string>& args)
+bool CommandMemory::isStaticCapable()
+{
+    return true;
+}
+
+
+void CommandMemory::waitIdle()
+{
+    this->pool.waitIdle();
+}
+
+
+bool CommandMemory::parseAddress(const string& text, word& address)
+{
+    //No sign, no spaces and nothing after the number:
+    if (text.empty() || !isxdigit((unsigned char)text[0]))
+    {
+        return false;
+    }
+
+    try
+    {
+        size_t end = 0;
+        address = stoul(text, &end, 16);
+
+        return end == text.size();
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+
+void CommandMemory::invokeRead(DebugLoop& loop, vector<string>& args)
+{
+    if (args.size() < 3)
+    {
+        cout << "Command syntax: \"memory read <hex address> <length> [file]\"." << endl;
+        return;
+    }
+
+    //Get the range:
+    word address = 0;
+    word length = 0;
+
+    if (!parseAddress(args[1], address))
+    {
+        cout << "Invalid address: \"" << args[1] << "\"." << endl;
+        return;
+    }
+
+    try
+    {
+        size_t end = 0;
+        length = stoul(args[2], &end, 0);
+
+        if (end != args[2].size())
+        {
+            throw invalid_argument(args[2]);
+        }
+    }
+    catch (...)
+    {
+        cout << "Second parameter (length) must be a number." << endl;
+        return;
+    }
+
+    //Dump to stdout resp. raw into a file:
+    bool raw = (args.size() >= 4);
+    int file = STDOUT_FILENO;
+
+    if (raw)
+    {
+        file = open(args[3].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (file < 0)
+        {
+            cout << "Failed to open \"" << args[3] << "\" (open error code: " << strerror(errno) << ")." << endl;
+            return;
+        }
+    }
+
+    cout.flush();
+
+    //Read and write chunk by chunk (chunks are line aligned, so the dump looks like a single one):
+    vector<byte> data(min(length, (word)MEMORY_COMMAND_CHUNK_BYTES));
+    vector<char> text;
+    word total = 0;
+    bool failed = false;
+
+    while (total < length)
+    {
+        word count = min(length - total, (word)MEMORY_COMMAND_CHUNK_BYTES);
+        word readCount = loop.getTracee().readMemory((pword)(address + total), count, &data[0]);
+
+        if (raw)
+        {
+            failed = !writeAll(file, (const char*)&data[0], readCount);
+        }
+        else
+        {
+            formatHexDump(address + total, &data[0], readCount, text);
+            failed = !text.empty() && !writeAll(file, &text[0], text.size());
+        }
+
+        total += readCount;
+
+        if (failed || (readCount < count))
+        {
+            break;
+        }
+    }
+
+    if (raw)
+    {
+        close(file);
+    }
+
+    if (failed)
+    {
+        cout << "Failed to write the output (write error code: " << strerror(errno) << ")." << endl;
+    }
+    else if (total < length)
+    {
+        cout << "Only 0x" << hex << total << " of 0x" << length << dec << " bytes are readable." << endl;
+    }
+
+    if (raw)
+    {
+        cout << "0x" << hex << total << dec << " bytes written to \"" << args[3] << "\"." << endl;
+    }
+}
+
+
+void CommandMemory::invokeWrite(DebugLoop& loop, vector<string>& args)
+{
+    if (args.size() < 3)
+    {
+        cout << "Command syntax: \"memory write <hex address> <hex bytes ...|file>\"." << endl;
+        return;
+    }
+
+    if (loop.getTracee().isStatic())
+    {
+        cout << "Writing memory needs a running process." << endl;
+        return;
+    }
+
+    word address = 0;
+
+    if (!parseAddress(args[1], address))
+    {
+        cout << "Invalid address: \"" << args[1] << "\"." << endl;
+        return;
+    }
+
+    //Hex bytes (maybe split into several parameters):
+    string hexBytes;
+    bool isHex = true;
+
+    for (size_t i = 2; (i < args.size()) && isHex; i++)
+    {
+        for (string::iterator it = args[i].begin(); it != args[i].end(); ++it)
+        {
+            isHex = isHex && isxdigit(*it);
+        }
+
+        hexBytes += args[i];
+    }
+
+    vector<byte> data;
+
+    if (isHex && ((hexBytes.size() % 2) == 0))
+    {
+        for (size_t i = 0; i < hexBytes.size(); i += 2)
+        {
+            data.push_back((byte)stoul(hexBytes.substr(i, 2), NULL, 16));
+        }
+    }
+    //Otherwise it's a file:
+    else
+    {
+        int file = open(args[2].c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (file < 0)
+        {
+            cout << "Parameter is neither hex bytes nor a readable file: \"" << args[2] << "\"." << endl;
+            return;
+        }
+
+        byte buffer[64 * 1024];
+        ssize_t count = 0;
+
+        while ((count = read(file, buffer, sizeof(buffer))) > 0)
+        {
+            data.insert(data.end(), buffer, buffer + count);
+        }
+
+        close(file);
+    }
+
+    //Write in chunks:
+    word total = 0;
+
+    try
+    {
+        while (total < data.size())
+        {
+            word count = min(data.size() - total, (word)MEMORY_COMMAND_CHUNK_BYTES);
+            word writeCount = loop.writeMemory((pword)(address + total), count, &data[total]);
+
+            total += writeCount;
+
+            if (writeCount < count)
+            {
+                break;
+            }
+        }
+    }
+    catch (const runtime_error& err)
+    {
+        cout << err.what() << endl;
+        return;
+    }
+
+    if (total < data.size())
+    {
+        cout << "Only 0x" << hex << total << " of 0x" << data.size() << dec << " bytes are writable." << endl;
+        return;
+    }
+
+    cout << "0x" << hex << total << " bytes written to 0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << address << dec << "." << endl;
+}
+
+
+vector<MemoryRegion> CommandMemory::getReadableRegions(DebugLoop& loop, const string& filter)
+{
+    vector<MemoryRegion> regions;
+
+    //Static mode has the loadable segments only:
+    if (loop.getTracee().isStatic())
+    {
+        const vector<ElfImageSegment>& segments = loop.getTracee().getImage()->getSegments();
+
+        for (vector<ElfImageSegment>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+        {
+            MemoryRegion region;
+            region.start = it->address;
+            region.end = it->address + it->memorySize;
+            region.readable = true;
+            region.writable = false;
+            region.executable = false;
+            region.shared = false;
+            region.offset = it->fileOffset;
+            region.path = loop.getTracee().getPath();
+
+            regions.push_back(region);
+        }
+    }
+    else
+    {
+        const vector<MemoryRegion>& allRegions = loop.getTracee().getMemoryMap().getRegions();
+
+        for (vector<MemoryRegion>::const_iterator it = allRegions.begin(); it != allRegions.end(); ++it)
+        {
+            //The kernel's pseudo regions can't be read like memory:
+            if (it->readable && (it->path != "[vvar]") && (it->path != "[vsyscall]"))
+            {
+                regions.push_back(*it);
+            }
+        }
+    }
+
+    if (filter.empty())
+    {
+        return regions;
+    }
+
+    //Filter by a range:
+    word start = 0;
+    word end = 0;
+    char separator = 0;
+
+    if ((istringstream(filter) >> hex >> start >> separator >> end) && (separator == '-') && (start < end))
+    {
+        vector<MemoryRegion> result;
+
+        for (vector<MemoryRegion>::iterator it = regions.begin(); it != regions.end(); ++it)
+        {
+            if ((it->end > start) && (it->start < end))
+            {
+                it->offset += max(it->start, start) - it->start;
+                it->start = max(it->start, start);
+                it->end = min(it->end, end);
+
+                result.push_back(*it);
+            }
+        }
+
+        return result;
+    }
+
+    //Filter by the path:
+    vector<MemoryRegion> result;
+
+    for (vector<MemoryRegion>::iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        if (it->path.find(filter) != string::npos)
+        {
+            result.push_back(*it);
+        }
+    }
+
+    return result;
+}
+
+
+void CommandMemory::invokeFind(DebugLoop& loop, vector<string>& args)
+{
+    if (args.size() < 2)
+    {
+        cout << "Command syntax: \"memory find <hex pattern (\"??\" for any byte)|\"string\"> [hex range <start>-<end>|path]\"." << endl;
+        return;
+    }
+
+    //Get the pattern (a quoted string may have been split at spaces):
+    string pattern = args[1];
+    size_t next = 2;
+
+    if (pattern[0] == '"')
+    {
+        while (((pattern.size() < 2) || (pattern[pattern.size() - 1] != '"')) && (next < args.size()))
+        {
+            pattern += " " + args[next++];
+        }
+
+        if ((pattern.size() < 2) || (pattern[pattern.size() - 1] != '"'))
+        {
+            cout << "The string is not terminated." << endl;
+            return;
+        }
+    }
+
+    try
+    {
+        PatternScanner scanner = (pattern[0] == '"') ? PatternScanner::fromString(pattern.substr(1, pattern.size() - 2)) : PatternScanner::fromHex(pattern);
+        vector<MemoryRegion> regions = getReadableRegions(loop, (next < args.size()) ? args[next] : "");
+
+        //Search chunk by chunk.
+        //Consecutive chunks overlap by the pattern length - 1, so no match gets lost at a border:
+        vector<byte> data(MEMORY_COMMAND_SCAN_CHUNK_BYTES + scanner.getLength() - 1);
+        vector<word> offsets;
+        word matchCount = 0;
+        word scannedBytes = 0;
+
+        for (vector<MemoryRegion>::iterator it = regions.begin(); it != regions.end(); ++it)
+        {
+            for (word chunkStart = it->start; chunkStart < it->end; chunkStart += MEMORY_COMMAND_SCAN_CHUNK_BYTES)
+            {
+                word count = min(it->end - chunkStart, (word)data.size());
+                word readCount = loop.getTracee().readMemory((pword)chunkStart, count, &data[0]);
+
+                offsets.clear();
+                scanner.find(&data[0], readCount, offsets);
+                scannedBytes += min(readCount, (word)MEMORY_COMMAND_SCAN_CHUNK_BYTES);
+
+                for (vector<word>::iterator it2 = offsets.begin(); it2 != offsets.end(); ++it2)
+                {
+                    if (matchCount++ < MEMORY_COMMAND_MAX_RESULTS)
+                    {
+                        cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << (chunkStart + *it2) << dec << ">\t" << (it->path.empty() ? "anonymous" : it->path) << endl;
+                    }
+                }
+
+                //The rest of the region is unreadable:
+                if (readCount < count)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (matchCount > MEMORY_COMMAND_MAX_RESULTS)
+        {
+            cout << "Only the first " << MEMORY_COMMAND_MAX_RESULTS << " matches are shown." << endl;
+        }
+
+        cout << matchCount << " matches in " << regions.size() << " regions (0x" << hex << scannedBytes << dec << " bytes scanned)." << endl;
+    }
+    catch (const runtime_error& err)
+    {
+        cout << err.what() << endl;
+    }
+}
+
+
+void CommandMemory::invokeRefs(DebugLoop& loop, vector<string>& args)
+{
+    if (args.size() < 2)
+    {
+        cout << "Command syntax: \"memory refs <hex address|hex range <start>-<end>> [hex range <start>-<end>|path]\"." << endl;
+        return;
+    }
+
+    //Get the target range (a single address is a range of one byte):
+    word targetStart = 0;
+    word targetEnd = 0;
+    char separator = 0;
+    istringstream targetStream(args[1]);
+
+    if (!(targetStream >> hex >> targetStart))
+    {
+        cout << "Invalid address: \"" << args[1] << "\"." << endl;
+        return;
+    }
+
+    if (!(targetStream >> separator >> targetEnd) || (separator != '-') || (targetEnd <= targetStart))
+    {
+        targetEnd = targetStart + 1;
+    }
+
+    //Split the regions into word aligned chunks (a range filter may have clipped a region at any address):
+    vector<MemoryRegion> regions = getReadableRegions(loop, (args.size() >= 3) ? args[2] : "");
+    vector<pair<word, word> > chunks;
+
+    for (vector<MemoryRegion>::iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        word alignedStart = (it->start + WORD_SIZE_BYTES - 1) & ~(word)(WORD_SIZE_BYTES - 1);
+        word alignedEnd = it->end & ~(word)(WORD_SIZE_BYTES - 1);
+
+        for (word chunkStart = alignedStart; chunkStart < alignedEnd; chunkStart += MEMORY_COMMAND_SCAN_CHUNK_BYTES)
+        {
+            chunks.push_back(make_pair(chunkStart, min(alignedEnd - chunkStart, (word)MEMORY_COMMAND_SCAN_CHUNK_BYTES)));
+        }
+    }
+
+    //Scan them in parallel (every task reads its chunk directly and collects the addresses of the hits):
+    ReferenceScanner scanner(targetStart, targetEnd);
+    vector<vector<word> > results(chunks.size());
+    vector<function<void()> > tasks;
+    Tracee& tracee = loop.getTracee();
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        tasks.push_back([&tracee, &scanner, &chunks, &results, i]()
+        {
+            word chunkStart = chunks[i].first;
+            vector<word> data(chunks[i].second / WORD_SIZE_BYTES);
+
+            if (data.empty())
+            {
+                return;
+            }
+            word readCount = tracee.readMemoryDirect((pword)chunkStart, data.size() * WORD_SIZE_BYTES, (pbyte)&data[0]) / WORD_SIZE_BYTES;
+
+            scanner.find(&data[0], readCount, results[i]);
+
+            for (vector<word>::iterator it = results[i].begin(); it != results[i].end(); ++it)
+            {
+                *it = chunkStart + *it * WORD_SIZE_BYTES;
+            }
+        });
+    }
+
+    this->pool.run(tasks);
+
+    //Print them in address order (the chunks are sorted already):
+    word matchCount = 0;
+    vector<MemoryRegion>::iterator region = regions.begin();
+
+    for (vector<vector<word> >::iterator it = results.begin(); it != results.end(); ++it)
+    {
+        for (vector<word>::iterator it2 = it->begin(); it2 != it->end(); ++it2)
+        {
+            if (matchCount++ >= MEMORY_COMMAND_MAX_RESULTS)
+            {
+                continue;
+            }
+
+            while (region->end <= *it2)
+            {
+                region++;
+            }
+
+            word value = 0;
+            tracee.readMemory((pword)*it2, WORD_SIZE_BYTES, (pbyte)&value);
+
+            //The location, the value, the region and the symbol of the location (for globals):
+            cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << *it2 << ">\t0x" << setw(2 * WORD_SIZE_BYTES) << value << dec << "\t" << (region->path.empty() ? "anonymous" : region->path);
+
+            string symbol = tracee.describeAddress(*it2);
+
+            if (!symbol.empty())
+            {
+                cout << "\t<" << symbol << ">";
+            }
+
+            cout << endl;
+        }
+    }
+
+    if (matchCount > MEMORY_COMMAND_MAX_RESULTS)
+    {
+        cout << "Only the first " << MEMORY_COMMAND_MAX_RESULTS << " references are shown." << endl;
+    }
+
+    cout << matchCount << " references in " << regions.size() << " regions (" << chunks.size() << " chunks scanned on " << this->pool.getThreadCount() << " threads)." << endl;
+}
+
+
+//Parse a value (decimal, hex with "0x" or negative):
+static bool parseValue(const string& text, uint64_t& value)
+{
+    try
+    {
+        size_t length = 0;
+        value = (text[0] == '-') ? (uint64_t)stoll(text, &length, 0) : stoull(text, &length, 0);
+
+        return length == text.size();
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+
+void CommandMemory::printCandidates(DebugLoop& loop)
+{
+    word count = this->valueScanner.getCount();
+
+    if (count <= MEMORY_COMMAND_MAX_LISTED_CANDIDATES)
+    {
+        for (word i = 0; i < count; i++)
+        {
+            word address = this->valueScanner.getAddress(i);
+            const MemoryRegion* region = loop.getTracee().getMemoryMap().findRegion(address);
+            string symbol = loop.getTracee().describeAddress(address);
+
+            cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << address << ">\t0x" << this->valueScanner.getValue(i) << dec << "\t" << ((region && !region->path.empty()) ? region->path : "anonymous");
+
+            if (!symbol.empty())
+            {
+                cout << "\t<" << symbol << ">";
+            }
+
+            cout << endl;
+        }
+    }
+
+    cout << count << " candidates." << endl;
+}
+
+
+void CommandMemory::invokeScan(DebugLoop& loop, vector<string>& args)
+{
+    if (args.size() < 3)
+    {
+        cout << "Command syntax: \"memory scan <value> <width (1, 2, 4 or 8)> [hex range <start>-<end>|path]\"." << endl;
+        return;
+    }
+
+    if (loop.getTracee().isStatic())
+    {
+        cout << "Scanning values needs a running process." << endl;
+        return;
+    }
+
+    uint64_t value = 0;
+    int width = atoi(args[2].c_str());
+
+    if (!parseValue(args[1], value))
+    {
+        cout << "Invalid value: \"" << args[1] << "\"." << endl;
+        return;
+    }
+
+    if ((width != 1) && (width != 2) && (width != 4) && (width != 8))
+    {
+        cout << "The width must be 1, 2, 4 or 8." << endl;
+        return;
+    }
+
+    //Variables live in writable memory:
+    vector<MemoryRegion> regions = getReadableRegions(loop, (args.size() >= 4) ? args[3] : "");
+    vector<MemoryRegion> writableRegions;
+
+    for (vector<MemoryRegion>::iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        if (it->writable)
+        {
+            writableRegions.push_back(*it);
+        }
+    }
+
+    this->valueScanner.scan(loop.getTracee(), writableRegions, value, width);
+    printCandidates(loop);
+
+    if (this->valueScanner.isTruncated())
+    {
+        cout << "The scan has stopped at " << VALUE_SCANNER_MAX_CANDIDATES << " candidates, please narrow it down with a range or a path." << endl;
+    }
+}
+
+
+void CommandMemory::invokeRescan(DebugLoop& loop, vector<string>& args)
+{
+    if (args.size() < 2)
+    {
+        cout << "Command syntax: \"memory rescan <changed|unchanged|increased|decreased|eq <value>>\"." << endl;
+        return;
+    }
+
+    if (this->valueScanner.getWidth() == 0)
+    {
+        cout << "There is no scan to narrow down (use \"memory scan\" first)." << endl;
+        return;
+    }
+
+    ValueScanMode mode = VALUE_SCAN_EQUAL;
+    uint64_t value = 0;
+
+    if (args[1] == "changed")
+    {
+        mode = VALUE_SCAN_CHANGED;
+    }
+    else if (args[1] == "unchanged")
+    {
+        mode = VALUE_SCAN_UNCHANGED;
+    }
+    else if (args[1] == "increased")
+    {
+        mode = VALUE_SCAN_INCREASED;
+    }
+    else if (args[1] == "decreased")
+    {
+        mode = VALUE_SCAN_DECREASED;
+    }
+    else if (args[1] == "eq")
+    {
+        if ((args.size() < 3) || !parseValue(args[2], value))
+        {
+            cout << "Parameter \"eq\" needs a value." << endl;
+            return;
+        }
+
+        //Compare with the value truncated to the width:
+        if (this->valueScanner.getWidth() < 8)
+        {
+            value &= (1ULL << (this->valueScanner.getWidth() * 8)) - 1;
+        }
+    }
+    else
+    {
+        cout << "Unknown parameter: \"" << args[1] << "\"." << endl;
+        return;
+    }
+
+    this->valueScanner.rescan(loop.getTracee(), mode, value);
+    printCandidates(loop);
+}
+
+
+void CommandMemory::invokeSnapshot(DebugLoop& loop, vector<string>& args)
+{
+    if (loop.getTracee().isStatic())
+    {
+        cout << "Snapshots need a running process." << endl;
+        return;
+    }
+
+    //Only writable memory can change:
+    vector<MemoryRegion> regions = getReadableRegions(loop, (args.size() >= 2) ? args[1] : "");
+    vector<MemoryRegion> writableRegions;
+
+    for (vector<MemoryRegion>::iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        if (it->writable)
+        {
+            writableRegions.push_back(*it);
+        }
+    }
+
+    this->snapshot.take(loop.getTracee(), writableRegions);
+
+    cout << "Snapshot of " << this->snapshot.getPageCount() << " pages taken (" << (this->snapshot.usesSoftDirty() ? "the written pages are tracked by the kernel" : "no soft-dirty support, every page will be compared") << ")." << endl;
+}
+
+
+void CommandMemory::invokeDiff(DebugLoop& loop, vector<string>& args)
 {
     UNUSED(args);
 
+    if (!this->snapshot.isTaken() || (this->snapshot.getPageCount() == 0))
+    {
+        cout << "There is no snapshot to compare with (use \"memory snapshot\" first)." << endl;
+        return;
+    }
+
+    vector<MemoryChange> changes;
+    word comparedCount = this->snapshot.diff(loop.getTracee(), changes);
+    word shownCount = min((word)changes.size(), (word)MEMORY_COMMAND_MAX_RESULTS);
+
+    for (word i = 0; i < shownCount; i++)
+    {
+        const MemoryChange& change = changes[i];
+        word length = min((word)change.before.size(), (word)MEMORY_COMMAND_MAX_DIFF_BYTES);
+
+        //The address, the size, the bytes before and after:
+        cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << change.address << ">\t0x" << change.before.size() << " bytes\t";
+
+        for (word j = 0; j < length; j++)
+        {
+            cout << setw(2) << (int)change.before[j];
+        }
+
+        cout << ((length < change.before.size()) ? "... -> " : " -> ");
+
+        for (word j = 0; j < length; j++)
+        {
+            cout << setw(2) << (int)change.after[j];
+        }
+
+        cout << ((length < change.after.size()) ? "..." : "") << dec << "\t" << (change.path.empty() ? "anonymous" : change.path);
+
+        string symbol = loop.getTracee().describeAddress(change.address);
+
+        if (!symbol.empty())
+        {
+            cout << "\t<" << symbol << ">";
+        }
+
+        cout << endl;
+    }
+
+    if (changes.size() > shownCount)
+    {
+        cout << "Only the first " << shownCount << " changes are shown." << endl;
+    }
+
+    cout << changes.size() << " changes in " << comparedCount << " of " << this->snapshot.getPageCount() << " pages compared (the snapshot has been updated)." << endl;
+}
+
+
+void CommandMemory::invoke(DebugLoop& loop, vector<string>& args)
+{
     //Always keep prompting:
     loop.setShowPrompt(true);
 
+    if (args.size() == 0)
+    {
+        cout << "Command syntax: \"memory <read|write|find|refs|scan|rescan|snapshot|diff> ...\"." << endl;
+        return;
+    }
 
+    if (args[0] == "read")
+    {
+        invokeRead(loop, args);
+    }
+    else if (args[0] == "write")
+    {
+        invokeWrite(loop, args);
+    }
+    else if (args[0] == "find")
+    {
+        invokeFind(loop, args);
+    }
+    else if (args[0] == "refs")
+    {
+        invokeRefs(loop, args);
+    }
+    else if (args[0] == "scan")
+    {
+        invokeScan(loop, args);
+    }
+    else if (args[0] == "rescan")
+    {
+        invokeRescan(loop, args);
+    }
+    else if (args[0] == "snapshot")
+    {
+        invokeSnapshot(loop, args);
+    }
+    else if (args[0] == "diff")
+    {
+        invokeDiff(loop, args);
+    }
+    else
+    {
+        cout << "Unknown parameter: \"" << args[0] << "\"." << endl;
+    }
 }
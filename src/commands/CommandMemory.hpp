@@ -4,13 +4,79 @@
 #include <string>
 #include <vector>
 
+#include "MemoryMap.hpp"
+#include "MemorySnapshot.hpp"
+#include "ThreadPool.hpp"
+#include "ValueScanner.hpp"
 #include "commands/Command.hpp"
 
+//The number of bytes read resp. written at once:
+#define MEMORY_COMMAND_CHUNK_BYTES (1024 * 1024)
+
+//The number of bytes per line of a hex dump:
+#define MEMORY_COMMAND_LINE_BYTES 16
+
+//The number of bytes scanned at once by a search:
+#define MEMORY_COMMAND_SCAN_CHUNK_BYTES (4 * 1024 * 1024)
+
+//The max number of results printed by a search:
+#define MEMORY_COMMAND_MAX_RESULTS 1000
+
+//The candidates of a value scan are listed up to that number:
+#define MEMORY_COMMAND_MAX_LISTED_CANDIDATES 20
+
+//The number of bytes shown per change of a diff:
+#define MEMORY_COMMAND_MAX_DIFF_BYTES 16
+
 using namespace std;
 
 class CommandMemory: public Command
 {
+    //Members:
+private:
+
+    //Scans the regions in parallel:
+    ThreadPool pool;
+
+    //The candidates of the value scan (they are kept between stops):
+    ValueScanner valueScanner;
+
+    //The snapshot for diffs (kept between stops as well):
+    MemorySnapshot snapshot;
+
     //Methods:
+private:
+
+    //Dump memory as hex resp. raw into a file:
+    void invokeRead(DebugLoop& loop, vector<string>& args);
+
+    //Write hex bytes resp. the content of a file to memory:
+    void invokeWrite(DebugLoop& loop, vector<string>& args);
+
+    //Search a pattern in all readable regions:
+    void invokeFind(DebugLoop& loop, vector<string>& args);
+
+    //Search the words pointing to an address resp. into a range in all readable regions:
+    void invokeRefs(DebugLoop& loop, vector<string>& args);
+
+    //Search a value in all writable regions resp. narrow the candidates down:
+    void invokeScan(DebugLoop& loop, vector<string>& args);
+    void invokeRescan(DebugLoop& loop, vector<string>& args);
+
+    //Show the number of candidates (and the candidates if there are only a few):
+    void printCandidates(DebugLoop& loop);
+
+    //Save the writable memory resp. show what has changed since then:
+    void invokeSnapshot(DebugLoop& loop, vector<string>& args);
+    void invokeDiff(DebugLoop& loop, vector<string>& args);
+
+    //Parse a hex address (false if it is not one):
+    static bool parseAddress(const string& text, word& address);
+
+    //Get the readable regions (the segments of the binary in static mode).
+    //The filter is a hex range "<start>-<end>" resp. a part of the path (empty for all regions):
+    vector<MemoryRegion> getReadableRegions(DebugLoop& loop, const string& filter);
+
 public:
 
     //Return the command strings the command should be registered for:
@@ -18,6 +84,12 @@ public:
 
     //Invoke the command:
     virtual void invoke(DebugLoop& loop, vector<string>& args);
+
+    //Can the command be used in static mode (without a process)?
+    virtual bool isStaticCapable();
+
+    //Wait until the scanning threads sleep:
+    virtual void waitIdle();
 };
 
 #endif // COMMANDMEMORY_H
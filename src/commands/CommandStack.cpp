@@ -3,6 +3,8 @@
 #include <iomanip>
 #include <iostream>
 
+#include "SymbolTable.hpp"
+
 vector<string> CommandStack::getCommandStrings()
 {
     return vector<string>({ "stack", "sta", "stk" });
@@ -34,31 +36,46 @@ void CommandStack::invoke(DebugLoop& loop, vector<string>& args)
         return;
     }
 
+    //Read all the words at once:
+    vector<word> words(wordCount > 0 ? wordCount : 0);
+    pword stackPointer = (pword)loop.getTracee().getRegisters().REG_SP;
+    int readCount = 0;
+
+    if (wordCount > 0)
+    {
+        readCount = loop.getTracee().readMemory(stackPointer, wordCount * WORD_SIZE_BYTES, (pbyte)&words[0]) / WORD_SIZE_BYTES;
+    }
+
     //Display:
-    try
+    for (int i = 0; i < readCount; i++)
     {
-        for (int i = 0; i < wordCount; i++)
-        {
-            pword address = ((pword)loop.getTracee().getRegisters().REG_SP) + i;
-            cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << (word)address << ">\t0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << loop.getTracee().peekWord(address) << dec;
+        pword address = stackPointer + i;
+        cout << "\t<0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << (word)address << ">\t0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << words[i] << dec;
+
+        //Additional info:
+        string symbol = loop.getTracee().describeAddress(words[i]);
 
-            //Additional info:
-            if (i == 0)
-            {
-                cout << "\t<-- stack pointer";
-            }
+        if (!symbol.empty())
+        {
+            cout << "\t<" << symbol << ">";
+        }
 
-            if (address == (pword)(loop.getTracee().getRegisters().REG_BP))
-            {
-                cout << "\t<-- base pointer";
-            }
+        if (i == 0)
+        {
+            cout << "\t<-- stack pointer";
+        }
 
-            cout << endl;
+        if (address == (pword)(loop.getTracee().getRegisters().REG_BP))
+        {
+            cout << "\t<-- base pointer";
         }
+
+        cout << endl;
     }
-    catch (runtime_error err)
+
+    //Not everything was readable:
+    if (readCount < wordCount)
     {
-        cout << err.what();
-        return;
+        cout << "Failed to read the stack at 0x" << setfill('0') << setw(2 * WORD_SIZE_BYTES) << hex << (word)(stackPointer + readCount) << dec << "." << endl;
     }
 }
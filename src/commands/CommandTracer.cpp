@@ -1,6 +1,7 @@
 #include "CommandTracer.hpp"
 
 #include <iostream>
+#include <stdlib.h>
 #include <sys/user.h>
 
 vector<string> CommandTracer::getCommandStrings()
@@ -18,7 +19,7 @@ void CommandTracer::invoke(DebugLoop& loop, vector<string>& args)
     //Show current tracing mode.
     if (args.size() == 0)
     {
-        cout << "Command syntax: \"trace mode\" to check/specify the mode or \"trace run\" to start tracing." << endl;
+        cout << "Command syntax: \"trace mode\" to check/specify the mode, \"trace overflow\" to check/specify what happens if the disk cannot keep up, \"trace regs\" to check/specify whether changed registers are traced or \"trace run [block]\" to start tracing (block: stop at taken branches only)." << endl;
         return;
     }
 
@@ -37,11 +38,13 @@ void CommandTracer::invoke(DebugLoop& loop, vector<string>& args)
                 case TRACING_MODE_NONE: cout << "none"; break;
                 case TRACING_MODE_STDOUT: cout << "stdout"; break;
                 case TRACING_MODE_FILE: cout << "file"; break;
+                case TRACING_MODE_BINARY: cout << "binary"; break;
 
                 default: cout << "-";
                 }
 
-                cout << "." << endl << "Possible modes: none, file, stdout." << endl;
+                cout << "." << endl << "Possible modes: none, file, binary, stdout." << endl;
+                cout << "Files are gzip compressed with \"trace mode file|binary <path> compress [level]\"." << endl;
                 return;
             }
 
@@ -61,8 +64,8 @@ void CommandTracer::invoke(DebugLoop& loop, vector<string>& args)
 
                 return;
             }
-            //File:
-            else if (args[1] == "file")
+            //File (text or binary):
+            else if ((args[1] == "file") || (args[1] == "binary"))
             {
                 if (args.size() < 3)
                 {
@@ -70,16 +73,50 @@ void CommandTracer::invoke(DebugLoop& loop, vector<string>& args)
                     return;
                 }
 
+                //Compressed ("... compress [level]" at the end)?
+                int compression = ASYNC_WRITER_UNCOMPRESSED;
+                vector<string>::iterator pathEnd = args.end();
+
+                if ((args.size() >= 4) && (args.back() == "compress"))
+                {
+                    compression = TRACE_DEFAULT_COMPRESSION;
+                    pathEnd = args.end() - 1;
+                }
+                else if ((args.size() >= 5) && (args[args.size() - 2] == "compress"))
+                {
+                    char* end;
+                    long level = strtol(args.back().c_str(), &end, 10);
+
+                    if ((*end != '\0') || (level < 0) || (level > 9))
+                    {
+                        cout << "The compression level must be between 0 and 9." << endl;
+                        return;
+                    }
+
+                    compression = (int)level;
+                    pathEnd = args.end() - 2;
+                }
+
                 //Fix args together again (yes, dirty ...):
                 string filePath = args[2];
 
-                for (vector<string>::iterator it = args.begin() + 3; it != args.end(); ++it)
+                for (vector<string>::iterator it = args.begin() + 3; it != pathEnd; ++it)
                 {
                     filePath += " " + *it;
                 }
 
-                loop.getTracer().selectFile(filePath);
-                cout << "Trace mode has been set to file." << endl;
+                string compressed = (compression != ASYNC_WRITER_UNCOMPRESSED) ? ", gzip compressed" : "";
+
+                if (args[1] == "binary")
+                {
+                    loop.getTracer().selectBinaryFile(filePath, compression);
+                    cout << "Trace mode has been set to binary" << compressed << " (\"ldb trace-dump <file>\" prints it as text)." << endl;
+                }
+                else
+                {
+                    loop.getTracer().selectFile(filePath, compression);
+                    cout << "Trace mode has been set to file" << compressed << "." << endl;
+                }
 
                 return;
             }
@@ -96,6 +133,56 @@ void CommandTracer::invoke(DebugLoop& loop, vector<string>& args)
         return;
     }
 
+    //What happens if the disk cannot keep up with the trace:
+    if (args[0] == "overflow")
+    {
+        if (args.size() < 2)
+        {
+            cout << "Current overflow handling: " << ((loop.getTracer().getOverflow() == ASYNC_WRITER_OVERFLOW_DROP) ? "drop" : "block") << "." << endl;
+            cout << "Dropped so far: " << loop.getTracer().getDroppedCount() << " block(s), " << loop.getTracer().getDroppedBytes() << " bytes." << endl;
+            cout << "Possible choices: block (wait for the disk), drop (skip blocks and count them)." << endl;
+            return;
+        }
+
+        if (args[1] == "block")
+        {
+            loop.getTracer().setOverflow(ASYNC_WRITER_OVERFLOW_BLOCK);
+        }
+        else if (args[1] == "drop")
+        {
+            loop.getTracer().setOverflow(ASYNC_WRITER_OVERFLOW_DROP);
+        }
+        else
+        {
+            cout << "Unknown overflow handling. \"trace overflow\" will display all valid choices." << endl;
+            return;
+        }
+
+        cout << "Overflow handling has been set to " << args[1] << " (applies to the next trace file)." << endl;
+        return;
+    }
+
+    //Tracing the changed registers:
+    if (args[0] == "regs")
+    {
+        if (args.size() < 2)
+        {
+            cout << "Tracing of changed registers is " << (loop.getTracer().getRecordRegisters() ? "on" : "off") << ". Possible choices: on, off." << endl;
+            return;
+        }
+
+        if ((args[1] != "on") && (args[1] != "off"))
+        {
+            cout << "Unknown parameter. Please use \"on\" or \"off\"." << endl;
+            return;
+        }
+
+        loop.getTracer().setRecordRegisters(args[1] == "on");
+        cout << "Tracing of changed registers has been turned " << args[1] << "." << endl;
+
+        return;
+    }
+
     //Starting the trace:
     if (args[0] == "run")
     {
@@ -105,15 +192,22 @@ void CommandTracer::invoke(DebugLoop& loop, vector<string>& args)
             return;
         }
 
-        //Enable the tracing:
-        loop.getTracer().setTracingActive(true);
+        //Step by step or from branch to branch:
+        bool blocks = false;
 
-        //Disable the prompt, enable the loop:
-        loop.setShowPrompt(false);
-        loop.setKeepLooping(true);
+        if (args.size() >= 2)
+        {
+            if (args[1] != "block")
+            {
+                cout << "Unknown parameter. Use \"trace run\" to trace with single steps or \"trace run block\" to stop at taken branches only." << endl;
+                return;
+            }
+
+            blocks = true;
+        }
 
-        //Initiate by performing a single step:
-        loop.getTracee().performStep();
+        //Start the tracing:
+        loop.startTrace(blocks);
 
         return;
     }